@@ -0,0 +1,386 @@
+//
+// Search benchmarks.
+//
+// usage: bench {col} {row} {p} scaling {seconds} {max threads} [search options]
+//   runs one search from the initial position for 1, 2, 4, ... up to {max threads} threads, once with the
+//   threads sharing one tree and once root parallel, and prints iterations/sec and the speedup over one thread.
+// usage: bench {col} {row} {p} clock {total seconds} [search options]
+//   plays one game between two StudentAIs, each with {total seconds} on its clock, and prints how much of the
+//   clock each side used, its longest move and whether it ran out of time.
+// usage: bench {col} {row} {p} playouts {count} [search options]
+//   runs {count} playouts from the initial position on one thread and prints playouts/sec and heap
+//   allocations per playout, the cost of the simulation step alone.
+// usage: bench {col} {row} {p} selection {iterations} [search options]
+//   grows a tree with {iterations} iterations on one thread, then times the selection phase alone: descents
+//   from the root in batches whose virtual loss is taken back afterwards, and prints the time per descent, the
+//   average depth reached and the width of the root. Runs from the opening and from a wide position with kings.
+// usage: bench {col} {row} {p} memory {iterations} [search options]
+//   grows a tree with {iterations} iterations on one thread and prints the memory per node, what the tree uses of
+//   its arena (nodes, child blocks, boards) plus anything it put on the heap, iterations/sec and the time
+//   release() takes. Compare --board-interval.
+// usage: bench {col} {row} {p} solver {iterations} [search options]
+//   plays one game on one thread, every move searching a fresh tree for up to {iterations} iterations, and prints
+//   the moves whose root the solver decided, when it did, and the share of the iteration budget that was saved.
+// usage: bench {col} {row} {p} rave {iterations} [search options]
+//   grows a tree with {iterations} iterations on one thread and prints the AMAF visits of every root child; exits
+//   with 1 when RAVE is on and one of them has none. Registered as a ctest check.
+// usage: bench {col} {row} {p} match {games} [search options of A] vs [search options of B]
+//   plays {games} games between two StudentAIs with their own options, taking turns at moving first, and prints
+//   A's wins, losses, draws and score and the clock time each side used. A seed is advanced by one per game.
+// search options are the same as for the main binary, e.g. --virtual-loss 1
+//
+
+#include "StudentAI.h"
+#include <climits>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+// every heap allocation of the process is counted, so benchmarks can report allocations per operation and
+// the heap bytes in use. Each block starts with a header holding its size, which keeps the count portable
+// (no malloc_usable_size) and the memory behind the header as aligned as malloc's.
+static atomic<long long> allocations(0);
+static atomic<long long> heapBytes(0);
+static const size_t HEADER = alignof(max_align_t);
+
+void* operator new(size_t size) {
+    allocations.fetch_add(1, memory_order_relaxed);
+    char *block = static_cast<char*>(malloc(HEADER + size));
+    if (block == nullptr) {
+        throw bad_alloc();
+    }
+    *reinterpret_cast<size_t*>(block) = size;
+    heapBytes.fetch_add(size, memory_order_relaxed);
+    return block + HEADER;
+}
+
+void* operator new(size_t size, const nothrow_t&) noexcept {
+    try {
+        return operator new(size);
+    } catch (const bad_alloc&) {
+        return nullptr;
+    }
+}
+
+void operator delete(void *p) noexcept {
+    if (p == nullptr) {
+        return;
+    }
+    char *block = static_cast<char*>(p) - HEADER;
+    heapBytes.fetch_sub(*reinterpret_cast<size_t*>(block), memory_order_relaxed);
+    free(block);
+}
+
+void operator delete(void *p, const nothrow_t&) noexcept {
+    operator delete(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    operator delete(p);
+}
+
+struct SearchResult {
+    int iterations;
+    double seconds;
+    size_t nodes;
+    Move best;
+};
+
+static SearchResult runSearch(Board &board, int player, const SearchConfig &config) {
+    SearchResult result;
+    if (config.rootParallel) {
+        auto start = high_resolution_clock::now();
+        result.best = MCTS::runRootParallel(board, player, INT_MAX, config, &result.iterations);
+        result.seconds = duration_cast<duration<double> >(high_resolution_clock::now() - start).count();
+        result.nodes = result.iterations + config.threads; // one node per iteration plus the roots, unless a tree filled up
+        return result;
+    }
+    TreeArena arena(config.treeMegabytes);
+    TranspositionTable table(config.tableMegabytes);
+    Node *root = MCTS::createRoot(arena, board, player);
+    MCTS mcts(root, board, player, config, &arena, &table);
+    auto start = high_resolution_clock::now();
+    result.iterations = mcts.runMCTS(INT_MAX);
+    result.seconds = duration_cast<duration<double> >(high_resolution_clock::now() - start).count();
+    result.nodes = arena.size();
+    result.best = mcts.getBestMove();
+    return result;
+}
+
+static void scaling(Board &board, double seconds, int maxThreads, SearchConfig config) {
+    config.moveSeconds = seconds;
+    cout << "mode  threads  iterations  iterations/sec  speedup     nodes  best move" << endl;
+    for (int root = 0; root <= 1; root++) {
+        config.rootParallel = root == 1;
+        double baseline = 0;
+        for (int threads = 1; threads <= maxThreads; threads *= 2) {
+            config.threads = threads;
+            SearchResult result = runSearch(board, 1, config);
+            double rate = result.iterations / result.seconds;
+            if (threads == 1) {
+                baseline = rate;
+            }
+            cout << (root ? "root" : "tree") << setw(9) << threads << setw(12) << result.iterations
+                 << setw(16) << fixed << setprecision(0) << rate << setw(9) << setprecision(2) << rate / baseline
+                 << setw(10) << result.nodes << "  " << result.best.toString() << endl;
+        }
+    }
+}
+
+static void clockGame(int col, int row, int p, double totalSeconds, SearchConfig config) {
+    config.totalSeconds = totalSeconds;
+    StudentAI first(col, row, p, config);
+    StudentAI second(col, row, p, config);
+    StudentAI *players[2] = {&first, &second};
+    double longest[2] = {0, 0};
+    int moves[2] = {0, 0};
+    Move last;
+    int winner = 0;
+    for (int turn = 0; winner == 0; turn = 1 - turn) {
+        auto start = high_resolution_clock::now();
+        last = players[turn]->GetMove(last);
+        double seconds = duration_cast<duration<double> >(high_resolution_clock::now() - start).count();
+        longest[turn] = max(longest[turn], seconds);
+        moves[turn]++;
+        winner = MCTS::checkWin(players[turn]->board);
+    }
+    cout << "side  moves  clock used  longest move  out of time" << endl;
+    for (int side = 0; side < 2; side++) {
+        double used = duration_cast<duration<double> >(players[side]->timeElapsed).count();
+        cout << setw(4) << side + 1 << setw(7) << moves[side] << fixed << setprecision(2)
+             << setw(11) << used << "s" << setw(13) << longest[side] << "s"
+             << setw(13) << (used > totalSeconds ? "yes" : "no") << endl;
+    }
+    cout << (winner == -1 ? "draw" : "player " + to_string(winner) + " wins") << endl;
+}
+
+static void playouts(Board &board, int count, const SearchConfig &config) {
+    TreeArena arena(1);
+    Node *root = MCTS::createRoot(arena, board, 1);
+    MCTS mcts(root, board, 1, config, &arena);
+    int results[4] = {0, 0, 0, 0}; // loss, win, draw for the side to move, and playouts cut off by --playout-depth
+    double totalScore = 0;
+    long long allocationsBefore = allocations.load();
+    auto start = high_resolution_clock::now();
+    for (int i = 0; i < count; i++) {
+        double score = mcts.simulation(root);
+        results[score == 0.0 ? 0 : score == 1.0 ? 1 : score == 0.5 ? 2 : 3]++;
+        totalScore += score;
+    }
+    double seconds = duration_cast<duration<double> >(high_resolution_clock::now() - start).count();
+    double allocationsPerPlayout = double(allocations.load() - allocationsBefore) / count;
+    cout << "playouts " << count << "  time " << fixed << setprecision(3) << seconds << "s"
+         << "  playouts/sec " << setprecision(0) << count / seconds
+         << "  allocations/playout " << setprecision(1) << allocationsPerPlayout
+         << "  wins " << results[1] << "  losses " << results[0] << "  draws " << results[2]
+         << "  evaluated " << results[3] << "  mean score " << setprecision(3) << totalScore / count << endl;
+}
+
+// kings on the dark squares of every other row, black in the lower half and white in the upper one, none of
+// them touching an enemy: nothing is blocked and there is no capture to force, so the root has dozens of moves,
+// several times as many as the opening
+static Board kingsPosition(const Board &board) {
+    Board kings(board);
+    for (int sq = 0; sq < kings.col * kings.row; sq++) {
+        if (kings.black.test(sq) || kings.white.test(sq)) {
+            kings.removePiece(sq);
+        }
+    }
+    for (int r = 1; r < kings.row; r += 2) {
+        for (int c = 0; c < kings.col; c++) {
+            if ((r + c) % 2 == 1) {
+                kings.placePiece(kings.square(r, c), r < kings.row / 2 ? 1 : 2, true);
+            }
+        }
+    }
+    kings.blackCount = kings.blackKings = kings.black.count();
+    kings.whiteCount = kings.whiteKings = kings.white.count();
+    kings.hashKey = kings.computeHash();
+    return kings;
+}
+
+static void selection(const char *label, Board &board, int iterations, SearchConfig config) {
+    config.threads = 1;
+    TreeArena arena(config.treeMegabytes);
+    TranspositionTable table(config.tableMegabytes);
+    Node *root = MCTS::createRoot(arena, board, 1);
+    MCTS mcts(root, board, 1, config, &arena, &table);
+    mcts.runMCTS(iterations);
+    // descents run in batches that keep their virtual loss, like concurrent iterations, so they spread over the tree
+    const int descents = 200000, batch = 64;
+    Node *leaves[batch];
+    long long depth = 0;
+    auto start = high_resolution_clock::now();
+    for (int i = 0; i < descents; i += batch) {
+        for (int j = 0; j < batch; j++) {
+            leaves[j] = mcts.selectNode(root);
+        }
+        for (int j = 0; j < batch; j++) {
+            for (Node *node = leaves[j]; node != root; node = node->parent) {
+                node->virtualLoss().fetch_sub(config.virtualLoss, memory_order_relaxed);
+                depth++;
+            }
+        }
+    }
+    double seconds = duration_cast<duration<double> >(high_resolution_clock::now() - start).count();
+    cout << label << "  tree " << arena.size() << " nodes  root children " << root->childCount.load()
+         << "  average depth " << fixed << setprecision(1) << double(depth) / descents
+         << "  selection " << setprecision(0) << seconds * 1e9 / descents << " ns/iteration"
+         << "  " << setprecision(1) << seconds * 1e9 / depth << " ns/level" << endl;
+}
+
+static void memory(Board &board, int iterations, SearchConfig config) {
+    config.threads = 1;
+    TreeArena arena(config.treeMegabytes);
+    long long heapBefore = heapBytes.load();
+    Node *root = MCTS::createRoot(arena, board, 1);
+    MCTS mcts(root, board, 1, config, &arena);
+    auto start = high_resolution_clock::now();
+    int done = mcts.runMCTS(iterations);
+    double seconds = duration_cast<duration<double> >(high_resolution_clock::now() - start).count();
+    size_t nodes = arena.size();
+    double arenaPerNode = double(arena.bytesUsed()) / nodes;
+    double heapPerNode = double(heapBytes.load() - heapBefore) / nodes;
+    auto releaseStart = high_resolution_clock::now();
+    arena.release();
+    double releaseSeconds = duration_cast<duration<double> >(high_resolution_clock::now() - releaseStart).count();
+    cout << "board interval " << config.boardInterval << "  nodes " << nodes << fixed << setprecision(0)
+         << "  bytes/node " << arenaPerNode + heapPerNode << " (" << arenaPerNode << " arena + " << heapPerNode << " heap)"
+         << "  nodes/GB " << 1e9 / (arenaPerNode + heapPerNode) << "  iterations/sec " << done / seconds
+         << "  release " << setprecision(1) << releaseSeconds * 1e6 << " us" << endl;
+}
+
+static void solverGame(Board &board, int iterations, SearchConfig config) {
+    config.threads = 1;
+    int player = 1, moves = 0, decided = 0;
+    long long used = 0;
+    auto start = high_resolution_clock::now();
+    while (MCTS::checkWin(board) == 0) {
+        TreeArena arena(config.treeMegabytes);
+        Node *root = MCTS::createRoot(arena, board, player);
+        MCTS mcts(root, board, player, config, &arena);
+        int done = mcts.runMCTS(iterations);
+        Move best = mcts.getBestMove();
+        signed char proven = root->proven().load();
+        if (proven == Node::PROVEN_WIN || proven == Node::PROVEN_LOSS) { // from the side of the previous mover
+            decided++;
+            cout << "move " << setw(3) << moves + 1 << "  player " << player << (proven == Node::PROVEN_LOSS ? " wins" : " loses")
+                 << " after " << setw(7) << done << " iterations  " << best.toString() << endl;
+        }
+        used += done;
+        moves++;
+        board.makeMove(best, player);
+        player = player == 1 ? 2 : 1;
+    }
+    double seconds = duration_cast<duration<double> >(high_resolution_clock::now() - start).count();
+    int winner = MCTS::checkWin(board);
+    cout << (winner == -1 ? "draw" : "player " + to_string(winner) + " wins") << " after " << moves << " moves  decided "
+         << decided << "  iterations " << used << " of " << (long long)iterations * moves << fixed << setprecision(1)
+         << " (" << 100.0 - 100.0 * used / ((double)iterations * moves) << "% saved)  time " << setprecision(2) << seconds << "s" << endl;
+}
+
+static int raveCheck(Board &board, int iterations, SearchConfig config) {
+    config.threads = 1;
+    TreeArena arena(config.treeMegabytes);
+    Node *root = MCTS::createRoot(arena, board, 1);
+    MCTS mcts(root, board, 1, config, &arena);
+    mcts.runMCTS(iterations);
+    int missing = 0;
+    for (int i = 0; i < root->children.size(); i++) {
+        int amafVisits = root->children.raveVisits()[i].load();
+        cout << setw(16) << root->children.moves()[i].toMove(board.col).toString() << "  visits " << setw(7)
+             << root->children.visits()[i].load() << "  AMAF visits " << setw(7) << amafVisits << endl;
+        if (amafVisits == 0) {
+            missing++;
+        }
+    }
+    return config.raveEquivalence > 0 && (root->children.size() == 0 || missing > 0) ? 1 : 0;
+}
+
+static void match(int col, int row, int p, int games, const SearchConfig &configA, const SearchConfig &configB) {
+    int wins = 0, losses = 0, draws = 0;
+    double used[2] = {0, 0};
+    for (int game = 0; game < games; game++) {
+        SearchConfig configs[2] = {configA, configB};
+        for (SearchConfig &config : configs) {
+            if (config.seed != 0) { // another game every time, still reproducible
+                config.seed += game;
+            }
+        }
+        StudentAI a(col, row, p, configs[0]);
+        StudentAI b(col, row, p, configs[1]);
+        bool aFirst = game % 2 == 0;
+        StudentAI *players[2] = {aFirst ? &a : &b, aFirst ? &b : &a};
+        Move last;
+        int winner = 0, moves = 0;
+        for (int turn = 0; winner == 0; turn = 1 - turn) {
+            last = players[turn]->GetMove(last);
+            moves++;
+            winner = MCTS::checkWin(players[turn]->board);
+        }
+        used[0] += duration_cast<duration<double> >(a.timeElapsed).count();
+        used[1] += duration_cast<duration<double> >(b.timeElapsed).count();
+        int aPlayer = aFirst ? 1 : 2;
+        if (winner == -1) {
+            draws++;
+        } else if (winner == aPlayer) {
+            wins++;
+        } else {
+            losses++;
+        }
+        cout << "game " << setw(3) << game + 1 << "  A is player " << aPlayer << "  " << setw(3) << moves << " moves  "
+             << (winner == -1 ? "draw" : winner == aPlayer ? "A wins" : "B wins") << endl;
+    }
+    cout << "A  wins " << wins << "  losses " << losses << "  draws " << draws << fixed << setprecision(1)
+         << "  score " << 100.0 * (wins + 0.5 * draws) / games << "%  clock used A " << setprecision(2) << used[0]
+         << "s  B " << used[1] << "s" << endl;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 5) {
+        cout << "usage: bench {col} {row} {p} scaling {seconds} {max threads} [search options]" << endl;
+        cout << "       bench {col} {row} {p} clock {total seconds} [search options]" << endl;
+        cout << "       bench {col} {row} {p} playouts {count} [search options]" << endl;
+        cout << "       bench {col} {row} {p} selection {iterations} [search options]" << endl;
+        cout << "       bench {col} {row} {p} memory {iterations} [search options]" << endl;
+        cout << "       bench {col} {row} {p} solver {iterations} [search options]" << endl;
+        cout << "       bench {col} {row} {p} rave {iterations} [search options]" << endl;
+        cout << "       bench {col} {row} {p} match {games} [search options of A] vs [search options of B]" << endl;
+        return 0;
+    }
+    int col = atoi(argv[1]);
+    int row = atoi(argv[2]);
+    int p = atoi(argv[3]);
+    string mode = argv[4];
+    Board board(col, row, p);
+    board.initializeGame();
+    if (mode == "scaling" && argc >= 7) {
+        scaling(board, atof(argv[5]), atoi(argv[6]), SearchConfig::parse(argc, argv, 7));
+    } else if (mode == "playouts" && argc >= 6) {
+        playouts(board, atoi(argv[5]), SearchConfig::parse(argc, argv, 6));
+    } else if (mode == "selection" && argc >= 6) {
+        Board kings = kingsPosition(board);
+        selection("opening", board, atoi(argv[5]), SearchConfig::parse(argc, argv, 6));
+        selection("kings  ", kings, atoi(argv[5]), SearchConfig::parse(argc, argv, 6));
+    } else if (mode == "memory" && argc >= 6) {
+        memory(board, atoi(argv[5]), SearchConfig::parse(argc, argv, 6));
+    } else if (mode == "solver" && argc >= 6) {
+        solverGame(board, atoi(argv[5]), SearchConfig::parse(argc, argv, 6));
+    } else if (mode == "rave" && argc >= 6) {
+        return raveCheck(board, atoi(argv[5]), SearchConfig::parse(argc, argv, 6));
+    } else if (mode == "match" && argc >= 6) {
+        int split = 6;
+        while (split < argc && strcmp(argv[split], "vs") != 0) {
+            split++;
+        }
+        SearchConfig configA = SearchConfig::parse(split, argv, 6);
+        match(col, row, p, atoi(argv[5]), configA, split < argc ? SearchConfig::parse(argc, argv, split + 1) : configA);
+    } else if (mode == "clock" && argc >= 6) {
+        clockGame(col, row, p, atof(argv[5]), SearchConfig::parse(argc, argv, 6));
+    } else {
+        cout << "unknown mode " << mode << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,91 @@
+//
+// Fixed-width square masks used by Board.
+//
+
+#ifndef CHECKER_TEACHER_BITBOARD_H
+#define CHECKER_TEACHER_BITBOARD_H
+
+#include <cstdint>
+
+// a mask has BITBOARD_WORDS 64-bit words, so boards up to 256 squares (16x16) are supported
+#define BITBOARD_WORDS 4
+#define BITBOARD_MAX_SQUARES (BITBOARD_WORDS * 64)
+
+// square index is row * col + col, so iterating bits in ascending order walks the board row by row
+struct BitBoard {
+    uint64_t w[BITBOARD_WORDS];
+
+    void clear() {
+        for (int i = 0; i < BITBOARD_WORDS; ++i)
+            w[i] = 0;
+    }
+    bool test(int sq) const {
+        return (w[sq >> 6] >> (sq & 63)) & 1ULL;
+    }
+    void set(int sq) {
+        w[sq >> 6] |= 1ULL << (sq & 63);
+    }
+    void reset(int sq) {
+        w[sq >> 6] &= ~(1ULL << (sq & 63));
+    }
+    bool any() const {
+        uint64_t acc = 0;
+        for (int i = 0; i < BITBOARD_WORDS; ++i)
+            acc |= w[i];
+        return acc != 0;
+    }
+    int count() const {
+        int total = 0;
+        for (int i = 0; i < BITBOARD_WORDS; ++i)
+            total += __builtin_popcountll(w[i]);
+        return total;
+    }
+    // index of the lowest set bit, or -1 if the mask is empty
+    int first() const {
+        for (int i = 0; i < BITBOARD_WORDS; ++i)
+            if (w[i])
+                return i * 64 + __builtin_ctzll(w[i]);
+        return -1;
+    }
+    // index of the lowest set bit strictly above sq, or -1
+    int next(int sq) const {
+        ++sq;
+        int i = sq >> 6;
+        if (i >= BITBOARD_WORDS)
+            return -1;
+        uint64_t bits = w[i] & (~0ULL << (sq & 63));
+        while (true) {
+            if (bits)
+                return i * 64 + __builtin_ctzll(bits);
+            if (++i >= BITBOARD_WORDS)
+                return -1;
+            bits = w[i];
+        }
+    }
+    BitBoard operator|(const BitBoard& rhs) const {
+        BitBoard r;
+        for (int i = 0; i < BITBOARD_WORDS; ++i)
+            r.w[i] = w[i] | rhs.w[i];
+        return r;
+    }
+    BitBoard operator&(const BitBoard& rhs) const {
+        BitBoard r;
+        for (int i = 0; i < BITBOARD_WORDS; ++i)
+            r.w[i] = w[i] & rhs.w[i];
+        return r;
+    }
+    BitBoard andNot(const BitBoard& rhs) const {
+        BitBoard r;
+        for (int i = 0; i < BITBOARD_WORDS; ++i)
+            r.w[i] = w[i] & ~rhs.w[i];
+        return r;
+    }
+    bool operator==(const BitBoard& rhs) const {
+        for (int i = 0; i < BITBOARD_WORDS; ++i)
+            if (w[i] != rhs.w[i])
+                return false;
+        return true;
+    }
+};
+
+#endif //CHECKER_TEACHER_BITBOARD_H
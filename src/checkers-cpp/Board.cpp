@@ -1,6 +1,75 @@
 #include "Board.h"
+#include "Random.h"
+#include <memory>
+#include <mutex>
 
 const map<string , string> Board::opponent = {{"W","B"},{"B","W"}};
+const ZobristKeys Board::zobrist;
+
+ZobristKeys::ZobristKeys()
+{
+    // splitmix64 with a fixed seed, so keys are the same in every run
+    uint64_t state = 0x2545F4914F6CDD1DULL;
+    auto next = [&state]() {
+        return splitMix64(state);
+    };
+    for (int sq = 0; sq < BITBOARD_MAX_SQUARES; ++sq)
+        for (int kind = 0; kind < 4; ++kind)
+            piece[sq][kind] = next();
+    whiteToMove = next();
+    for (int i = 0; i < TIE_BUCKETS; ++i)
+        tieBucket[i] = next();
+}
+
+static inline int tieBucket(int tieCount)
+{
+    int bucket = tieCount / TIE_BUCKET_SIZE;
+    return bucket < 0 ? 0 : bucket >= TIE_BUCKETS ? TIE_BUCKETS - 1 : bucket;
+}
+
+const int BoardGeometry::dirRow[4] = {1, 1, -1, -1};
+const int BoardGeometry::dirCol[4] = {-1, 1, -1, 1};
+const int BoardGeometry::exploreOrder[3][4] = {{0, 1, 2, 3}, {0, 1, 2, 3}, {2, 3, 0, 1}};
+
+const BoardGeometry* BoardGeometry::get(int col, int row)
+{
+    static map<pair<int, int>, unique_ptr<BoardGeometry> > cache;
+    static mutex cacheMutex;
+    lock_guard<mutex> lock(cacheMutex);
+    unique_ptr<BoardGeometry>& entry = cache[make_pair(col, row)];
+    if (!entry)
+    {
+        entry.reset(new BoardGeometry());
+        BoardGeometry& g = *entry;
+        g.col = col;
+        g.row = row;
+        g.squares = col * row;
+        for (int i = 1; i <= 2; ++i)
+            g.promotionRow[i].clear();
+        g.promotionRow[0].clear();
+        for (int r = 0; r < row; ++r)
+        {
+            for (int c = 0; c < col; ++c)
+            {
+                int sq = r * col + c;
+                for (int d = 0; d < 4; ++d)
+                {
+                    int r1 = r + dirRow[d], c1 = c + dirCol[d];
+                    int r2 = r1 + dirRow[d], c2 = c1 + dirCol[d];
+                    bool in1 = r1 >= 0 && r1 < row && c1 >= 0 && c1 < col;
+                    bool in2 = r2 >= 0 && r2 < row && c2 >= 0 && c2 < col;
+                    g.step[sq][d] = in1 ? r1 * col + c1 : -1;
+                    g.jump[sq][d] = in1 && in2 ? r2 * col + c2 : -1;
+                }
+                if (r == row - 1)
+                    g.promotionRow[1].set(sq);
+                if (r == 0)
+                    g.promotionRow[2].set(sq);
+            }
+        }
+    }
+    return entry.get();
+}
 
 Board::Board()
 {
@@ -9,6 +78,16 @@ Board::Board()
     p = 0;
     this->blackCount = 0;
     this->whiteCount = 0;
+    this->blackKings = 0;
+    this->whiteKings = 0;
+    this->tieCount = 0;
+    this->tieMax = 40;
+    this->geometry = nullptr;
+    this->sideToMove = 1;
+    black.clear();
+    white.clear();
+    kings.clear();
+    this->hashKey = zobrist.tieBucket[0];
 }
 Board::Board(int col, int row,int p)
 {
@@ -17,17 +96,145 @@ Board::Board(int col, int row,int p)
     this->p = p;
     this->blackCount = 0;
     this->whiteCount = 0;
+    this->blackKings = 0;
+    this->whiteKings = 0;
     this->tieCount = 0;
     this->tieMax = 40;
-    this->board = vector<vector<Checker> >(row);
-    for (int i = 0;i < row; ++i)
+    if (col <= 0 || row <= 0 || col * row > BITBOARD_MAX_SQUARES)
     {
-        for (int j = 0;j<col;++j)
-        {
-            board[i].push_back(Checker(".",i,j));
-        }
+        cerr<<"Board larger than "<<BITBOARD_MAX_SQUARES<<" squares"<<endl;
+        throw InvalidParameterError();
     }
+    this->geometry = BoardGeometry::get(col, row);
+    this->sideToMove = 1;
+    black.clear();
+    white.clear();
+    kings.clear();
+    this->hashKey = zobrist.tieBucket[0];
+}
+
+// everything but the history, so a scratch board can take over a position without allocating
+void Board::copyState(const Board& other)
+{
+    this->black = other.black;
+    this->white = other.white;
+    this->kings = other.kings;
+    this->geometry = other.geometry;
+    this->hashKey = other.hashKey;
+    this->sideToMove = other.sideToMove;
+    this->col = other.col;
+    this->row = other.row;
+    this->p = other.p;
+    this->blackCount = other.blackCount;
+    this->whiteCount = other.whiteCount;
+    this->blackKings = other.blackKings;
+    this->whiteKings = other.whiteKings;
+    this->tieCount = other.tieCount;
+    this->tieMax = other.tieMax;
+    this->saved_move_list.clear();
+}
 
+int Board::pieceAt(int row, int col) const
+{
+    int sq = square(row, col);
+    if (black.test(sq))
+        return 1;
+    if (white.test(sq))
+        return 2;
+    return 0;
+}
+
+bool Board::isKingAt(int row, int col) const
+{
+    return kings.test(square(row, col));
+}
+
+string Board::colorAt(int row, int col) const
+{
+    int piece = pieceAt(row, col);
+    return piece == 1 ? "B" : piece == 2 ? "W" : ".";
+}
+
+void Board::setColorAt(int row, int col, const string& color)
+{
+    int sq = square(row, col);
+    hashKey ^= pieceKey(sq);
+    black.reset(sq);
+    white.reset(sq);
+    if (color == "B")
+        black.set(sq);
+    else if (color == "W")
+        white.set(sq);
+    hashKey ^= pieceKey(sq);
+}
+
+Checker Board::getChecker(int row, int col) const
+{
+    Checker checker(colorAt(row, col), row, col);
+    checker.isKing = isKingAt(row, col);
+    return checker;
+}
+
+void Board::placePiece(int sq, int player, bool king)
+{
+    hashKey ^= pieceKey(sq);
+    black.reset(sq);
+    white.reset(sq);
+    if (player == 1)
+        black.set(sq);
+    else
+        white.set(sq);
+    if (king)
+        kings.set(sq);
+    else
+        kings.reset(sq);
+    hashKey ^= pieceKey(sq);
+}
+
+void Board::removePiece(int sq)
+{
+    hashKey ^= pieceKey(sq);
+    black.reset(sq);
+    white.reset(sq);
+    kings.reset(sq);
+}
+
+// the piece on sq is about to be jumped by player
+void Board::countCapture(int sq, int player)
+{
+    if (player == 1)
+    {
+        this->whiteCount--;
+        if (this->kings.test(sq))
+            this->whiteKings--;
+    }
+    else
+    {
+        this->blackCount--;
+        if (this->kings.test(sq))
+            this->blackKings--;
+    }
+}
+
+uint64_t Board::pieceKey(int sq) const
+{
+    int king = kings.test(sq) ? 1 : 0;
+    if (black.test(sq))
+        return zobrist.piece[sq][king];
+    if (white.test(sq))
+        return zobrist.piece[sq][2 + king];
+    return 0;
+}
+
+uint64_t Board::computeHash() const
+{
+    uint64_t key = zobrist.tieBucket[tieBucket(tieCount)];
+    if (sideToMove == 2)
+        key ^= zobrist.whiteToMove;
+    BitBoard occupied = black | white;
+    for (int sq = occupied.first(); sq != -1; sq = occupied.next(sq))
+        key ^= pieceKey(sq);
+    return key;
 }
 
 
@@ -45,7 +252,7 @@ void Board::showBoard()
         cout << i << "|" ;
         for (int j = 0; j < col; ++j)
         {
-            cout << setw(3) << this->board[i][j].toString();
+            cout << setw(3) << this->getChecker(i, j).toString();
         }
         cout << endl;
     }
@@ -65,24 +272,24 @@ void Board::initializeGame(){
         {
             // put white pieces
             int i_white = this->row - this->p + i;
-            this->board[i_white][j] = Checker("W", i_white, j);
+            this->placePiece(square(i_white, j), 2, false);
             // put black pieces
             if ((this->row % 2 + this->p % 2) % 2 == 1)  // row,k = even,odd or odd,even
             {
                 if (i % 2 == 1)  // even row, shift to the left and attach a peice to the end when needed
                 {
                     if (j - 1 >= 0)
-                        this->board[i][j-1] = Checker("B", i, j-1);
+                        this->placePiece(square(i, j-1), 1, false);
                     if ((j == this->col -2) && (this->col % 2 == 0))
-                        this->board[i][this->col-1] = Checker("B", i, this->col-1);
+                        this->placePiece(square(i, this->col-1), 1, false);
                 } else {  // odd row, shift to the right and attach a piece to the beginning when needed
                     if (j + 1 <= this->col -1)
-                        this->board[i][j+1] = Checker("B", i, j+1);
+                        this->placePiece(square(i, j+1), 1, false);
                     if ((j == this->col - 1 || j == this->col - 2) && (this->p % 2 == 0))
-                        this->board[i][0] = Checker("B", i, 0);
+                        this->placePiece(square(i, 0), 1, false);
                 }
             } else {  // row,p = even,even
-                this->board[i][j] = Checker("B", i, j);
+                this->placePiece(square(i, j), 1, false);
             }
             this->blackCount++;
             this->whiteCount++;
@@ -115,152 +322,288 @@ void Board::checkInitialVariable() {
 }
 
 bool Board::isValidMove(int chess_row, int chess_col, int target_row, int target_col, string turn)
+{
+    return this->isValidMove(chess_row, chess_col, target_row, target_col, turn == "B" ? 1 : turn == "W" ? 2 : 0);
+}
+
+bool Board::isValidMove(int chess_row, int chess_col, int target_row, int target_col, int player)
 {
     if (target_row < 0||target_row >= this->row||target_col < 0||target_col >= this->col)
 
         return false;
-    if  (! (this->board[target_row][target_col].color == "."))
+    if (!this->isInBoard(chess_row, chess_col) || (player != 1 && player != 2))
 
         return false;
-    if  (! (this->board[chess_row][chess_col].color == turn))
+    if  (this->pieceAt(target_row, target_col) != 0)
+
+        return false;
+    if  (this->pieceAt(chess_row, chess_col) != player)
 
         return false;
     int diff_col = target_col - chess_col;
     int diff_row = target_row - chess_row;
     if (abs(diff_col) != abs(diff_row))
         return false;
-    Checker chess_being_moved = this->board[chess_row][chess_col];
-    if (diff_row == 1 && diff_col == 1)
-        return chess_being_moved.isKing||chess_being_moved.color == "B";
-    if (diff_row == 1 && diff_col == -1)
-        return chess_being_moved.isKing||chess_being_moved.color == "B";
-    if (diff_row == -1 && diff_col == 1  )
-        return chess_being_moved.isKing||chess_being_moved.color == "W";
-    if (diff_row == -1 && diff_col == -1  )
-        return chess_being_moved.isKing||chess_being_moved.color == "W";
-    if (diff_row == 2 && diff_col == 2 )
-        return (chess_being_moved.isKing||chess_being_moved.color == "B") && this->board[chess_row + 1][chess_col + 1].color != turn && this->board[chess_row + 1][chess_col + 1].color != ".";
-    if (diff_row == 2 && diff_col == -2 )
-        return (chess_being_moved.isKing||chess_being_moved.color == "B") && this->board[chess_row + 1][chess_col - 1].color != turn && this->board[chess_row + 1][chess_col - 1].color != ".";
-    if (diff_row == -2 && diff_col == 2 )
-        return (chess_being_moved.isKing||chess_being_moved.color == "W") && this->board[chess_row - 1][chess_col + 1].color != turn && this->board[chess_row - 1][chess_col + 1].color != ".";
-    if (diff_row == -2 && diff_col == -2 )
-        return (chess_being_moved.isKing||chess_being_moved.color == "W") && this->board[chess_row - 1][chess_col - 1].color != turn && this->board[chess_row - 1][chess_col - 1].color != ".";
+    bool is_king = this->isKingAt(chess_row, chess_col);
+    if (diff_row == 1 && abs(diff_col) == 1)
+        return is_king || player == 1;
+    if (diff_row == -1 && abs(diff_col) == 1)
+        return is_king || player == 2;
+    if (abs(diff_row) == 2)
+    {
+        int jumped = this->pieceAt(chess_row + diff_row / 2, chess_col + diff_col / 2);
+        bool forward = diff_row == 2 ? player == 1 : player == 2;
+        return (is_king || forward) && jumped != player && jumped != 0;
+    }
     return false;
 
 }
 
 vector<vector<Move> > Board::getAllPossibleMoves(string color) {
-    vector<vector<Move> > temp;
-    for (int i = 0; i < row; i++) {
-        for (int j = 0; j < col; j++) {
-            Checker checker = board[i][j];
-            if (checker.color == color) {
-                vector<Move> moves;
-                moves = checker.getPossibleMoves(this);
-                if (!moves.empty())
-                    temp.push_back(moves);
-            }
+    return this->getAllPossibleMoves(color == "B" ? 1 : color == "W" ? 2 : 0);
+}
 
-        }
+// adapts a vector to the MoveList calls of the generator
+struct VectorMoveSink {
+    vector<CompactMove>& moves;
+    void clear() { moves.clear(); }
+    int size() const { return (int)moves.size(); }
+    const CompactMove& operator[](int i) const { return moves[i]; }
+    void push(const CompactMove& move) { moves.push_back(move); }
+    void erase(int begin, int end) { moves.erase(moves.begin() + begin, moves.begin() + end); }
+    void closeGroup() {}
+    void dropGroups() {}
+};
+
+// only counts the finished jump sequences
+struct CountingMoveSink {
+    int count;
+    void push(const CompactMove&) { ++count; }
+};
+
+// a VectorMoveSink that also remembers where every group starts, like MoveList
+struct GroupedMoveSink : VectorMoveSink {
+    vector<int> groupStart;
+    explicit GroupedMoveSink(vector<CompactMove>& moves) : VectorMoveSink{moves}, groupStart(1, 0) {}
+    void closeGroup() { groupStart.push_back(size()); }
+    void dropGroups() { groupStart.resize(1); }
+};
+
+vector<vector<Move> > Board::getAllPossibleMoves(int player) {
+    // the compact generator is the only one, its moves are converted group by group
+    vector<CompactMove> compact;
+    GroupedMoveSink sink(compact);
+    generateMoves(player, sink, false);
+    vector<vector<Move> > result(sink.groupStart.size() - 1);
+    for (size_t g = 0; g < result.size(); ++g)
+    {
+        result[g].reserve(sink.groupStart[g + 1] - sink.groupStart[g]);
+        for (int i = sink.groupStart[g]; i < sink.groupStart[g + 1]; ++i)
+            result[g].push_back(compact[i].toMove(col));
     }
-    bool hasCapture = false;
-    vector<vector<Move> > result;
-    int cursorToResult = 0;
-    for (int cursorToTemp = 0; cursorToTemp < temp.size(); ++cursorToTemp)
+    return result;
+}
+
+void Board::getAllPossibleMoves(int player, vector<CompactMove>& moves) const
+{
+    VectorMoveSink sink{moves};
+    generateMoves(player, sink, false);
+}
+
+void Board::getAllPossibleMoves(int player, MoveList& moves) const
+{
+    generateMoves(player, moves, false);
+}
+
+void Board::getCaptureMoves(int player, MoveList& moves) const
+{
+    generateMoves(player, moves, true);
+}
+
+int Board::countPossibleMoves(int player) const
+{
+    if (player != 1 && player != 2)
+        return 0;
+    const BoardGeometry& g = *geometry;
+    const int* order = BoardGeometry::exploreOrder[player];
+    const BitBoard& own = pieces(player);
+    BitBoard occupied = black | white;
+    BitBoard enemies = pieces(3 - player);
+    CountingMoveSink jumps{0};
+    int simple = 0;
+    for (int sq = own.first(); sq != -1; sq = own.next(sq))
     {
-        vector<Move> VectorI;
-        result.push_back(VectorI);
-        for (int j = 0; j < temp[cursorToTemp].size(); ++j)
+        int dirCount = kings.test(sq) ? 4 : 2;
+        if (jumps.count == 0)
         {
-            if (! hasCapture)
+            for (int i = 0; i < dirCount; ++i)
             {
-                if (temp[cursorToTemp][j].isCapture())
-                {
-                    hasCapture = true;
-                    result.clear();
-                    vector<Move> firstVector;
-                    firstVector.push_back(temp[cursorToTemp][j]);
-                    result.push_back(firstVector);
-                    cursorToResult = 0;
-                }
-                else{
-                    result[cursorToResult].push_back(temp[cursorToTemp][j]);
-                }
+                int target = g.step[sq][order[i]];
+                if (target >= 0 && !occupied.test(target))
+                    ++simple;
             }
-            else{
-                if (temp[cursorToTemp][j].isCapture())
-                {
-                    result[cursorToResult].push_back(temp[cursorToTemp][j]);
-                }
-            }
-
         }
-        if (result[cursorToResult].size() == 0 )
+        CompactMove current;
+        occupied.reset(sq);
+        jumpSearch(sq, player, dirCount, occupied, enemies, current, jumps);
+        occupied.set(sq);
+    }
+    return jumps.count > 0 ? jumps.count : simple;
+}
+
+bool Board::hasAnyLegalMove(int player) const
+{
+    if (player != 1 && player != 2)
+        return false;
+    const BoardGeometry& g = *geometry;
+    const int* order = BoardGeometry::exploreOrder[player];
+    const BitBoard& own = pieces(player);
+    const BitBoard& enemies = pieces(3 - player);
+    BitBoard occupied = black | white;
+    for (int sq = own.first(); sq != -1; sq = own.next(sq))
+    {
+        int dirCount = kings.test(sq) ? 4 : 2;
+        for (int i = 0; i < dirCount; ++i)
         {
-            result.erase(result.begin() + cursorToResult);
-            --cursorToResult;
+            int target = g.step[sq][order[i]];
+            if (target < 0)
+                continue;
+            if (!occupied.test(target))
+                return true;
+            int land = g.jump[sq][order[i]];
+            if (land >= 0 && enemies.test(target) && !occupied.test(land))
+                return true;
         }
-        ++cursorToResult;
     }
-    return result;
+    return false;
 }
 
-vector<vector<Move> > Board::getAllPossibleMoves(int player) {
-    vector<vector<Move> > temp;
-    string color = player == 1?"B" : "W";
-    for (int i = 0; i < row; i++) {
-        for (int j = 0; j < col; j++) {
-            Checker checker = board[i][j];
-            if (checker.color == color) {
-                vector<Move> moves;
-                moves = checker.getPossibleMoves(this);
-                if (!moves.empty())
-                    temp.push_back(moves);
-            }
+int Board::gameResult() const
+{
+    if (this->tieCount >= this->tieMax)
+        return -1;
+    if (this->blackCount == 0)
+        return 2;
+    if (this->whiteCount == 0)
+        return 1;
+    if (!hasAnyLegalMove(1))
+        return 2;
+    if (!hasAnyLegalMove(2))
+        return 1;
+    return 0;
+}
 
+// one group per piece in row-major order, once any piece can capture only capturing pieces are kept
+// simple moves are not generated any more once a capture has been found, or at all for capturesOnly
+template <class Sink>
+void Board::generateMoves(int player, Sink& moves, bool capturesOnly) const
+{
+    moves.clear();
+    if (player != 1 && player != 2)
+        return;
+    const BitBoard& own = pieces(player);
+    bool hasCapture = false;
+    for (int sq = own.first(); sq != -1; sq = own.next(sq))
+    {
+        int begin = moves.size();
+        getPieceMoves(sq, player, moves, hasCapture || capturesOnly);
+        if (moves.size() == begin)
+            continue;
+        if (moves[begin].capture && !hasCapture)
+        {
+            hasCapture = true;
+            moves.erase(0, begin);
+            moves.dropGroups();
         }
+        moves.closeGroup();
     }
-    bool hasCapture = false;
-    vector<vector<Move> > result;
-    int cursorToResult = 0;
-    for (int cursorToTemp = 0; cursorToTemp < temp.size(); ++cursorToTemp)
+}
+
+template <class Sink>
+void Board::getPieceMoves(int sq, int player, Sink& moves, bool capturesOnly) const
+{
+    const BoardGeometry& g = *geometry;
+    const int* order = BoardGeometry::exploreOrder[player];
+    int dirCount = kings.test(sq) ? 4 : 2;
+    BitBoard occupied = black | white;
+    int begin = moves.size();
+    CompactMove current;
+    current.from = sq;
+    if (!capturesOnly)
     {
-        vector<Move> VectorI;
-        result.push_back(VectorI);
-        for (int j = 0; j < temp[cursorToTemp].size(); ++j)
+        for (int i = 0; i < dirCount; ++i)
         {
-            if (! hasCapture)
+            int target = g.step[sq][order[i]];
+            if (target >= 0 && !occupied.test(target))
             {
-                if (temp[cursorToTemp][j].isCapture())
-                {
-                    hasCapture = true;
-                    result.clear();
-                    vector<Move> firstVector;
-                    firstVector.push_back(temp[cursorToTemp][j]);
-                    result.push_back(firstVector);
-                    cursorToResult = 0;
-                }
-                else{
-                    result[cursorToResult].push_back(temp[cursorToTemp][j]);
-                }
-            }
-            else{
-                if (temp[cursorToTemp][j].isCapture())
-                {
-                    result[cursorToResult].push_back(temp[cursorToTemp][j]);
-                }
+                CompactMove simple = current;
+                simple.pushStep(order[i]);
+                simple.to = target;
+                moves.push(simple);
             }
+        }
+    }
+    occupied.reset(sq);
+    BitBoard enemies = pieces(3 - player);
+    int simpleEnd = moves.size();
+    current.capture = true;
+    jumpSearch(sq, player, dirCount, occupied, enemies, current, moves);
+    if (moves.size() > simpleEnd)  // jumps replace the simple moves
+        moves.erase(begin, simpleEnd);
+}
 
+// depth first search over the jump sequences of the piece on start, in exploreOrder, with an explicit stack
+// instead of recursion: a frame per landing square on the current path and the next direction to try there.
+// A captured piece is lifted at once, later jumps may land on its square but cannot take it twice, and the
+// moving piece must already be lifted from occupied. A sequence ends where no further jump is possible, or at
+// CompactMove::MAX_STEPS jumps.
+template <class Sink>
+void Board::jumpSearch(int start, int player, int dirCount, BitBoard& occupied, BitBoard& enemies, CompactMove& current, Sink& moves) const
+{
+    struct Frame
+    {
+        int sq;
+        int next;
+        bool extended;
+    };
+    const BoardGeometry& g = *geometry;
+    const int* order = BoardGeometry::exploreOrder[player];
+    Frame stack[CompactMove::MAX_STEPS + 1];
+    int top = 0;
+    stack[0] = Frame{start, 0, false};
+    while (true)
+    {
+        Frame& frame = stack[top];
+        if (frame.next < dirCount && top < CompactMove::MAX_STEPS)
+        {
+            int d = order[frame.next++];
+            int over = g.step[frame.sq][d];
+            int land = g.jump[frame.sq][d];
+            if (land < 0 || !enemies.test(over) || occupied.test(land))
+                continue;
+            frame.extended = true;
+            enemies.reset(over);
+            occupied.reset(over);
+            current.captured.set(over);
+            current.pushStep(d);
+            stack[++top] = Frame{land, 0, false};
+            continue;
         }
-        if (result[cursorToResult].size() == 0 )
+        if (top == 0)
+            return;
+        if (!frame.extended)
         {
-            result.erase(result.begin() + cursorToResult);
-            --cursorToResult;
+            current.to = frame.sq;
+            moves.push(current);
         }
-        ++cursorToResult;
+        // take back the jump that led here, its direction is the last one on the path
+        --top;
+        int over = g.step[stack[top].sq][current.direction(current.steps - 1)];
+        current.popStep();
+        current.captured.reset(over);
+        enemies.set(over);
+        occupied.set(over);
     }
-    return result;
 }
 
 bool Board::isInBoard(int pos_x, int pos_y)
@@ -270,100 +613,57 @@ bool Board::isInBoard(int pos_x, int pos_y)
 
 void Board::makeMove(const Move& move, int player)
 {
-    //DO NOT TOUCH ANYTHING IN THIS FUNCTION
-    //THE CODE LOGIC IS FROM PYTHON VERSION
+    //SAME RULES AS THE PYTHON VERSION, APPLIED TO THE MASKS
     Saved_Move temp_saved_move;
-    temp_saved_move.maked_move = move;
-    
-    vector<vector<int>> saved_enemy_position;
-    string turn = "";
-
-    if (player == 1)
-        turn = "B";
-    else if (player == 2)
-        turn = "W";
-    else {
+    temp_saved_move.captured.clear();
+    temp_saved_move.captured_kings.clear();
+    temp_saved_move.player = player;
+    temp_saved_move.become_king = false;
+    temp_saved_move.saved_tie_count = this->tieCount;
+    temp_saved_move.saved_side_to_move = this->sideToMove;
+    temp_saved_move.saved_hash = this->hashKey;
+
+    if (player != 1 && player != 2)
+        throw InvalidMoveError();
+    const vector<Position>& move_list = move.seq;
+    if (move_list.empty())
         throw InvalidMoveError();
-    }
-    vector<Position> move_list = move.seq;
-    vector<vector<Position> > move_to_check;
     Position ultimate_start = move_list[0];
-    bool is_start_checker_king = this->board[ultimate_start[0]][ultimate_start[1]].isKing;
-    Position ultimate_end = move_list[move_list.size()-1];
-    vector<Position> past_positions{ultimate_start};
-    vector<Position> capture_positions;
-    for (int i = 0;i<move_list.size()-1;++i)
-        move_to_check.push_back(vector<Position>{move_list[i],move_list[i + 1]});
+    if (!this->isInBoard(ultimate_start.x, ultimate_start.y))
+        throw InvalidMoveError();
+    temp_saved_move.from = temp_saved_move.to = square(ultimate_start.x, ultimate_start.y);
+    bool is_start_checker_king = this->kings.test(temp_saved_move.from);
 
     bool if_capture = false;
     this->tieCount += 1;
-    for (int t = 0; t<move_to_check.size();++t){
-        Position  start = move_to_check[t][0];
-        Position target= move_to_check[t][1];
-        if (this->isValidMove(start[0],start[1],target[0],target[1],turn) || (if_capture  && abs(start[0]-target[0]) == 1)){
-            this->board[start[0]][start[1]].color = ".";
-            this->board[target[0]][target[1]].color = turn;
-            this->board[target[0]][target[1]].isKing = this->board[start[0]][start[1]].isKing;
-            this->board[start[0]][start[1]].becomeMan();
-            past_positions.push_back(target);
-            if (abs(start[0]-target[0]) == 2)
+    for (size_t t = 0; t + 1 < move_list.size(); ++t){
+        Position start = move_list[t];
+        Position target = move_list[t + 1];
+        if (this->isValidMove(start.x, start.y, target.x, target.y, player)
+            || (if_capture && abs(start.x - target.x) == 1 && this->isInBoard(target.x, target.y))){
+            int start_sq = square(start.x, start.y);
+            int target_sq = square(target.x, target.y);
+            bool is_king = this->kings.test(start_sq);
+            this->removePiece(start_sq);
+            this->placePiece(target_sq, player, is_king);
+            temp_saved_move.to = target_sq;
+            if (abs(start.x - target.x) == 2)
             {
-                vector<int> temp_enemy_position;
                 if_capture = true;
                 this->tieCount = 0;
-                Position capture_position {(start[0] + (int)(target[0]-start[0])/2), (start[1] + (int)(target[1]-start[1])/2)};
-                if(turn == "B")
-                    this->whiteCount--;
-                else
-                    this->blackCount--;
-
-                capture_positions.push_back(capture_position);
-                //record capture position
-                temp_enemy_position.push_back(capture_position[0]); // row
-                temp_enemy_position.push_back(capture_position[1]); // col
-                // push back color 1 = "B" 2 = "W"
-                if(this->board[capture_position[0]][capture_position[1]].color == "B"){
-                    temp_enemy_position.push_back(1);
-                }
-                else{
-                    temp_enemy_position.push_back(2);
-                }
-                // the checker is regular or king, 0 = regular, 1 = king
-                if(this->board[capture_position[0]][capture_position[1]].isKing){
-                    temp_enemy_position.push_back(1);
-                }
-                else{temp_enemy_position.push_back(0);}
-                
-                saved_enemy_position.push_back(temp_enemy_position);
-                
-                this->board[capture_position[0]][capture_position[1]] = Checker(".", capture_position[0], capture_position[1]);
-                
-                
+                int capture_sq = square(start.x + (target.x - start.x) / 2, start.y + (target.y - start.y) / 2);
+                this->countCapture(capture_sq, player);
+                temp_saved_move.captured.set(capture_sq);
+                if (this->kings.test(capture_sq))
+                    temp_saved_move.captured_kings.set(capture_sq);
+                this->removePiece(capture_sq);
             }
-            if (turn == "B"  && target[0] == this->row - 1){
-                if(!is_start_checker_king){
-                    temp_saved_move.become_king = true;
-                }
-                else{
-                    temp_saved_move.become_king = false;
-                }
-                
-                this->board[target[0]][target[1]].becomeKing();
-                if (!is_start_checker_king){
-                        break;
-                }
-            }
-            
-            else if (turn == "W"  && target[0] == 0){
-                if(!is_start_checker_king){
-                    temp_saved_move.become_king = true;
-                }
-                else{
-                    temp_saved_move.become_king = false;
-                }
-                
-                this->board[target[0]][target[1]].becomeKing();
+            // black is crowned on the last row, white on the first
+            if (this->geometry->promotionRow[player].test(target_sq)){
+                temp_saved_move.become_king = !is_start_checker_king;
+                this->placePiece(target_sq, player, true);
                 if (!is_start_checker_king){
+                        (player == 1 ? this->blackKings : this->whiteKings)++;
                         break;
                 }
             }
@@ -376,11 +676,78 @@ void Board::makeMove(const Move& move, int player)
         }
 
     }
-    temp_saved_move.saved_enemy_list = saved_enemy_position;
-    saved_move_list.push_back(temp_saved_move);
+    finishMove(temp_saved_move);
+}
+
 
+// the steps of makeMove(Move) without the checks and without building Move positions
+void Board::makeMove(const CompactMove& move, int player)
+{
+    if (move.empty() || (player != 1 && player != 2))
+        throw InvalidMoveError();
+    const BoardGeometry& g = *geometry;
+    Saved_Move saved;
+    saved.captured.clear();
+    saved.captured_kings.clear();
+    saved.player = player;
+    saved.become_king = false;
+    saved.saved_tie_count = this->tieCount;
+    saved.saved_side_to_move = this->sideToMove;
+    saved.saved_hash = this->hashKey;
+    saved.from = move.from;
+    this->tieCount += 1;
+    int sq = move.from;
+    bool is_start_checker_king = this->kings.test(sq);
+    bool is_king = is_start_checker_king;
+    for (int i = 0; i < move.steps; ++i)
+    {
+        int d = move.direction(i);
+        int target_sq = move.capture ? g.jump[sq][d] : g.step[sq][d];
+        this->removePiece(sq);
+        this->placePiece(target_sq, player, is_king);
+        if (move.capture)
+        {
+            int capture_sq = g.step[sq][d];
+            this->tieCount = 0;
+            this->countCapture(capture_sq, player);
+            saved.captured.set(capture_sq);
+            if (this->kings.test(capture_sq))
+                saved.captured_kings.set(capture_sq);
+            this->removePiece(capture_sq);
+        }
+        sq = target_sq;
+        if (g.promotionRow[player].test(target_sq))
+        {
+            this->placePiece(target_sq, player, true);
+            is_king = true;
+            if (!is_start_checker_king)
+            {
+                (player == 1 ? this->blackKings : this->whiteKings)++;
+                saved.become_king = true;
+                break;
+            }
+        }
+    }
+    saved.to = sq;
+    finishMove(saved);
 }
 
+// the pieces have been moved and hashed, side to move and the tieCount bucket are updated once per move
+void Board::finishMove(const Saved_Move& saved)
+{
+    this->hashKey ^= zobrist.tieBucket[tieBucket(saved.saved_tie_count)] ^ zobrist.tieBucket[tieBucket(this->tieCount)];
+    if (this->sideToMove == 2)
+        this->hashKey ^= zobrist.whiteToMove;
+    this->sideToMove = saved.player == 1 ? 2 : 1;
+    if (this->sideToMove == 2)
+        this->hashKey ^= zobrist.whiteToMove;
+    if (this->recordHistory)
+    {
+        if (saved_move_list.capacity() == 0)
+            saved_move_list.reserve(HISTORY_RESERVE);
+        saved_move_list.push_back(saved);
+    }
+}
 
 int Board::isWin(int turn) {
     if (this->tieCount >= this->tieMax){
@@ -388,24 +755,19 @@ int Board::isWin(int turn) {
     }
     bool W = true;
     bool B = true;
-    if (getAllPossibleMoves(1).size() == 0) {
+    if (!hasAnyLegalMove(1)) {
         if (turn != 1)
             B = false;
-    } else if (getAllPossibleMoves(2).size() == 0) {
+    } else if (!hasAnyLegalMove(2)) {
         if (turn != 2)
             W = false;
     } else {
-        for (int row = 0; row < this->row; row++) {
-            for (int col = 0; col < this->col; col++) {
-                Checker checker = this->board[row][col];
-                if (checker.color == "W")
-                    W = false;
-                else if (checker.color == "B")
-                    B = false;
-                if (!W && !B)
-                    return 0;
-            }
-        }
+        if (this->white.any())
+            W = false;
+        if (this->black.any())
+            B = false;
+        if (!W && !B)
+            return 0;
     }
     if (W)
         return 2;
@@ -428,10 +790,10 @@ int Board::isWin(string turn_s) {
         turn = 2;
     else if (turn_s == "B")
         turn = 1;
-    if (getAllPossibleMoves(1).size() == 0) {
+    if (!hasAnyLegalMove(1)) {
         if (turn != 1)
             BHasMove = false;
-    } else if (getAllPossibleMoves(2).size() == 0) {
+    } else if (!hasAnyLegalMove(2)) {
         if (turn != 2)
             WHasMove = false;
     }
@@ -443,17 +805,12 @@ int Board::isWin(string turn_s) {
     {
         return 1;
     }
-    for (int row = 0; row < this->row; row++) {
-        for (int col = 0; col < this->col; col++) {
-            Checker checker = this->board[row][col];
-            if (checker.color == "W")
-                W = false;
-            else if (checker.color == "B")
-                B = false;
-            if (!W && !B)
-                return 0;
-        }
-    }
+    if (this->white.any())
+        W = false;
+    if (this->black.any())
+        B = false;
+    if (!W && !B)
+        return 0;
 
     if (W)
         return 2;
@@ -466,53 +823,25 @@ int Board::isWin(string turn_s) {
 
 void Board:: Undo(){
     if(!saved_move_list.empty()){
-        Saved_Move temp_saved_move = saved_move_list.back();
-        Position original_point = temp_saved_move.maked_move.seq[0];
-        Position target_point = temp_saved_move.maked_move.seq[temp_saved_move.maked_move.seq.size()-1];
-        
-        this->board[original_point[0]][original_point[1]].color = this->board[target_point[0]][target_point[1]].color;
-        if(temp_saved_move.become_king){
-            this->board[original_point[0]][original_point[1]].isKing = false;
+        const Saved_Move& temp_saved_move = saved_move_list.back();
+        int player = temp_saved_move.player;
+        bool is_king = !temp_saved_move.become_king && this->kings.test(temp_saved_move.to);
+        if (temp_saved_move.become_king)
+            (player == 1 ? this->blackKings : this->whiteKings)--;
+        this->removePiece(temp_saved_move.to);
+        this->placePiece(temp_saved_move.from, player, is_king);
+
+        const BitBoard& captured = temp_saved_move.captured;
+        for (int sq = captured.first(); sq != -1; sq = captured.next(sq)){
+            bool was_king = temp_saved_move.captured_kings.test(sq);
+            this->placePiece(sq, 3 - player, was_king);
+            (player == 1 ? this->whiteCount : this->blackCount)++;
+            if (was_king)
+                (player == 1 ? this->whiteKings : this->blackKings)++;
         }
-        else{
-            this->board[original_point[0]][original_point[1]].isKing = this->board[target_point[0]][target_point[1]].isKing;
-        }
-        
-        if(!(target_point == original_point)){
-            this->board[target_point[0]][target_point[1]].color = ".";
-            this->board[target_point[0]][target_point[1]].isKing = false;
-        }
-        for(int i = 0; i < temp_saved_move.saved_enemy_list.size(); i++){
-            int x = temp_saved_move.saved_enemy_list[i][0];
-            int y = temp_saved_move.saved_enemy_list[i][1];
-            int c = temp_saved_move.saved_enemy_list[i][2];
-            int k = temp_saved_move.saved_enemy_list[i][3];
-            
-            this->board[x][y].color = (c==1?"B":"W");
-            this->board[x][y].isKing = (k==0?false:true);
-
-            }
-        this->tieCount -= 1;
+        this->tieCount = temp_saved_move.saved_tie_count;
+        this->sideToMove = temp_saved_move.saved_side_to_move;
+        this->hashKey = temp_saved_move.saved_hash;
         saved_move_list.pop_back();
-        
-        
-    }
-    this->blackCount = 0;
-    this->whiteCount = 0;
-    for (int row = 0; row < this->row; row++) {
-        for (int col = 0; col < this->col; col++) {
-            if (this->board[row][col].color == "W")
-            {
-                this->whiteCount++;
-            }
-            else if (this->board[row][col].color == "B")
-            {
-                 this->blackCount++;
-            }
-            
-        }
     }
 }
-
-
-
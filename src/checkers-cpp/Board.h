@@ -8,35 +8,107 @@
 #include <set>
 #include "Move.h"
 #include "Checker.h"
+#include "Bitboard.h"
+#include "CompactMove.h"
+#include "MoveList.h"
 
 using namespace std;
 
+// tieCount is hashed in buckets so positions close to the 40 move draw do not share statistics with fresh ones
+#define TIE_BUCKET_SIZE 10
+#define TIE_BUCKETS 8
+
+// everything Undo needs to take back one makeMove, plain data so the history never allocates per move
 struct Saved_Move{
-    Move maked_move;
-    vector<vector<int>> saved_enemy_list; //<row, col, color(1/2 indicate "B"/"W", is_king>
+    BitBoard captured;       // squares of the jumped pieces, all of the opponent's color
+    BitBoard captured_kings; // the kings among them
+    int16_t from, to;        // where the moving piece started and where it ended up
+    int8_t player;
     bool become_king;
+    int saved_tie_count;
+    int saved_side_to_move;
+    uint64_t saved_hash;
+};
+
+// random keys for the incremental position hash, shared by every board size
+struct ZobristKeys {
+    uint64_t piece[BITBOARD_MAX_SQUARES][4]; // black man, black king, white man, white king
+    uint64_t whiteToMove;
+    uint64_t tieBucket[TIE_BUCKETS];
+    ZobristKeys();
+};
+
+// per (col,row) lookup tables shared by every Board of that size
+// directions are 0 = (1,-1), 1 = (1,1), 2 = (-1,-1), 3 = (-1,1), i.e. black's forward moves first
+struct BoardGeometry {
+    int col, row, squares;
+    short step[BITBOARD_MAX_SQUARES][4]; // neighbour square in each direction, -1 if off the board
+    short jump[BITBOARD_MAX_SQUARES][4]; // landing square two steps away, -1 if off the board
+    BitBoard promotionRow[3];            // indexed by player, the row where a man of that player is crowned
+    static const int dirRow[4];
+    static const int dirCol[4];
+    static const int exploreOrder[3][4]; // per player: own directions first, then the king-only ones
+    static const BoardGeometry* get(int col, int row);
 };
 
 class Board {
 public:
-	vector<vector<Checker> > board;
+    BitBoard black, white, kings;
+    const BoardGeometry* geometry;
+    uint64_t hashKey;  // zobrist key of pieces, side to move and tieCount bucket, kept up to date by makeMove/Undo
+    int sideToMove;
     static const map<string , string> opponent;
+    static const ZobristKeys zobrist;
 	int col, row, p, blackCount,whiteCount,tieCount,tieMax;
-    vector<Saved_Move> saved_move_list;
+    int blackKings, whiteKings; // kings among blackCount/whiteCount, kept up to date by makeMove/Undo like the counts
+    vector<Saved_Move> saved_move_list; // reserved HISTORY_RESERVE records up front on the first move
+    bool recordHistory = true; // playout boards turn this off, Undo has nothing to restore then
+    static const int HISTORY_RESERVE = 256;
 	Board();
 	Board(int col, int row,int p);
     void initializeGame ();
     bool isInBoard(int pos_x,int pos_y);
     bool isValidMove(int chess_row, int chess_col, int target_row, int target_col, string turn);
+    bool isValidMove(int chess_row, int chess_col, int target_row, int target_col, int player);
     void checkInitialVariable();
     vector<vector<Move> > getAllPossibleMoves(string color);
     vector<vector<Move> > getAllPossibleMoves(int player);
+    void getAllPossibleMoves(int player, vector<CompactMove>& moves) const; // same moves and order, flattened, moves is cleared first
+    void getAllPossibleMoves(int player, MoveList& moves) const; // same moves, groups and order, nothing is allocated
+    void getCaptureMoves(int player, MoveList& moves) const;     // only capturing moves, empty when no piece can capture
+    int countPossibleMoves(int player) const;                    // number of legal moves, nothing is stored
+    bool hasAnyLegalMove(int player) const;                      // stops at the first simple move or jump found
+    // -1 for a draw by tieMax, 1 or 2 when that color has won because the other one has no pieces or no moves
+    // (black is asked first), 0 while the game goes on. Uses the piece counts, generates no moves.
+    int gameResult() const;
     void makeMove(const Move& move,int player);
+    void makeMove(const CompactMove& move, int player); // for generated moves, not validated
 	int isWin(int turn);
 	int isWin(string turn);
 	void Undo();
 	void showBoard();
 
+    // square level access to the masks
+    int square(int row, int col) const { return row * this->col + col; }
+    int pieceAt(int row, int col) const; // 0 = empty, 1 = black, 2 = white
+    bool isKingAt(int row, int col) const;
+    string colorAt(int row, int col) const;
+    void setColorAt(int row, int col, const string& color); // changes the color only, like assigning Checker::color
+    Checker getChecker(int row, int col) const;
+    void placePiece(int sq, int player, bool king);
+    void removePiece(int sq);
+    const BitBoard& pieces(int player) const { return player == 1 ? black : white; } // iterate with first()/next()
+    uint64_t computeHash() const;  // full recomputation of hashKey, for validation
+    void copyState(const Board& other); // takes over other's position, the history is cleared, not copied
+
+private:
+    uint64_t pieceKey(int sq) const;
+    void countCapture(int sq, int player);
+    void finishMove(const Saved_Move& saved); // side to move, hash and history after the pieces have moved
+    // the move generator, shared by the vector, MoveList and counting front ends
+    template <class Sink> void generateMoves(int player, Sink& moves, bool capturesOnly) const;
+    template <class Sink> void getPieceMoves(int sq, int player, Sink& moves, bool capturesOnly) const;
+    template <class Sink> void jumpSearch(int start, int player, int dirCount, BitBoard& occupied, BitBoard& enemies, CompactMove& current, Sink& moves) const;
 };
 
 
@@ -57,15 +57,15 @@ vector<Move> Checker::getPossibleMoves(Board* board)
         int pos_y = col+(*i)[1];
         if (board->isInBoard(pos_x,pos_y))
         {
-            if (board->board[pos_x][pos_y].color == ".")
+            if (board->colorAt(pos_x,pos_y) == ".")
             {
                 result.emplace_back(Move(vector<Position>{Position(row,col),Position(pos_x,pos_y)}));
             }
         }
     }
     vector<Position> temp_v;
-    string self_color =  board->board[row][col].color;
-    board->board[row][col].color = ".";
+    string self_color =  board->colorAt(row,col);
+    board->setColorAt(row,col,".");
     binary_tree_traversal(row,col,multiple_jump, *board, explore_direction, temp_v,self_color);
     if (!multiple_jump.empty())
     {
@@ -77,7 +77,7 @@ vector<Move> Checker::getPossibleMoves(Board* board)
         result.emplace_back(Move(*jump));
     }
 
-    board->board[row][col].color = self_color;
+    board->setColorAt(row,col,self_color);
     return result;
 
 }
@@ -89,9 +89,9 @@ void Checker::binary_tree_traversal(int pos_x,int pos_y,vector<vector<Position>>
         int temp_y = pos_y + (*i)[1];
         Position temp(temp_x, temp_y);
         if (board.isInBoard(temp_x, temp_y)
-        && board.board[temp_x][temp_y].color == opponent.at(self_color)
+        && board.colorAt(temp_x,temp_y) == opponent.at(self_color)
             && board.isInBoard(temp_x + (*i)[0], temp_y + (*i)[1])
-            && board.board[temp_x + (*i)[0]][temp_y + (*i)[1]].color == ".")
+            && board.colorAt(temp_x + (*i)[0],temp_y + (*i)[1]) == ".")
         {
             flag = false;
             break;
@@ -110,16 +110,16 @@ void Checker::binary_tree_traversal(int pos_x,int pos_y,vector<vector<Position>>
         int temp_x = pos_x + (*i)[0];
         int temp_y = pos_y + (*i)[1];
         Position temp(temp_x, temp_y);
-        if (board.isInBoard(temp_x, temp_y) && board.board[temp_x][temp_y].color == opponent.at(self_color)){
+        if (board.isInBoard(temp_x, temp_y) && board.colorAt(temp_x,temp_y) == opponent.at(self_color)){
             if (board.isInBoard(pos_x + (*i)[0] + (*i)[0], pos_y + (*i)[1] + (*i)[1]) &&
-                board.board[pos_x + (*i)[0] + (*i)[0]][pos_y + (*i)[1] + (*i)[1]].color == ".") {
+                board.colorAt(pos_x + (*i)[0] + (*i)[0],pos_y + (*i)[1] + (*i)[1]) == ".") {
                 Position temptemp{pos_x + (*i)[0] + (*i)[0], pos_y + (*i)[1] + (*i)[1]};
-                string backup = board.board[pos_x + (*i)[0]][pos_y + (*i)[1]].color;
-                board.board[pos_x + (*i)[0]][pos_y + (*i)[1]].color = ".";
+                string backup = board.colorAt(pos_x + (*i)[0],pos_y + (*i)[1]);
+                board.setColorAt(pos_x + (*i)[0],pos_y + (*i)[1],".");
                 move.push_back(temptemp);
                 this->binary_tree_traversal(temptemp[0], temptemp[1], multiple_jump, board, direction, move,self_color);
                 move.pop_back();
-                board.board[pos_x + (*i)[0]][pos_y + (*i)[1]].color = backup;
+                board.setColorAt(pos_x + (*i)[0],pos_y + (*i)[1],backup);
             }
 
         }
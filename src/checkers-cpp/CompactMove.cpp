@@ -0,0 +1,57 @@
+//
+// Fixed-size move encoding used inside the search.
+//
+
+#include "CompactMove.h"
+#include <cstdlib>
+
+static const int stepRow[4] = {1, 1, -1, -1};
+static const int stepCol[4] = {-1, 1, -1, 1};
+
+CompactMove CompactMove::fromMove(const Move& move, int col)
+{
+    CompactMove result;
+    const vector<Position>& seq = move.seq;
+    if (seq.empty())
+        return result;
+    if (seq.size() < 2 || seq.size() > MAX_STEPS + 1)
+        throw MoveBuildError();
+    int distance = abs(seq[1].x - seq[0].x);
+    if (distance != 1 && distance != 2)
+        throw MoveBuildError();
+    result.capture = distance == 2;
+    if (!result.capture && seq.size() != 2)
+        throw MoveBuildError();
+    result.from = seq[0].x * col + seq[0].y;
+    for (size_t i = 0; i + 1 < seq.size(); ++i)
+    {
+        int dr = seq[i + 1].x - seq[i].x;
+        int dc = seq[i + 1].y - seq[i].y;
+        if (abs(dr) != distance || abs(dc) != distance)
+            throw MoveBuildError();
+        result.pushStep((dr < 0 ? 2 : 0) + (dc > 0 ? 1 : 0));
+        if (result.capture)
+            result.captured.set((seq[i].x + dr / 2) * col + seq[i].y + dc / 2);
+    }
+    result.to = seq.back().x * col + seq.back().y;
+    return result;
+}
+
+Move CompactMove::toMove(int col) const
+{
+    vector<Position> seq;
+    if (empty())
+        return Move(seq);
+    seq.reserve(steps + 1);
+    int r = from / col, c = from % col;
+    int distance = capture ? 2 : 1;
+    seq.push_back(Position(r, c));
+    for (int i = 0; i < steps; ++i)
+    {
+        int d = direction(i);
+        r += stepRow[d] * distance;
+        c += stepCol[d] * distance;
+        seq.push_back(Position(r, c));
+    }
+    return Move(std::move(seq));
+}
@@ -0,0 +1,56 @@
+//
+// Fixed-size move encoding used inside the search.
+//
+
+#ifndef CHECKER_TEACHER_COMPACTMOVE_H
+#define CHECKER_TEACHER_COMPACTMOVE_H
+
+#include "Bitboard.h"
+#include "Move.h"
+#include <cstdint>
+
+// a move as its start square and the direction of every step, 2 bits each, plus the mask of the jumped pieces
+// directions use the BoardGeometry numbering, 0 = (1,-1), 1 = (1,1), 2 = (-1,-1), 3 = (-1,1); a step is one
+// square for a simple move and two for a jump. No heap memory, so move lists and tree nodes can hold it by value.
+// Move is still the type at the protocol boundary, fromMove/toMove convert between the two without loss.
+struct CompactMove {
+    static const int MAX_STEPS = 64;
+    BitBoard captured;  // squares of the jumped pieces, empty for a simple move
+    uint64_t path[2];   // direction of step i in bits 2i..2i+1 of path[i / 32]
+    int16_t from;       // start square, row * col + col
+    int16_t to;         // square the piece ends on
+    uint8_t steps;      // 1 for a simple move, the number of jumps otherwise
+    bool capture;
+
+    CompactMove() : from(-1), to(-1), steps(0), capture(false) {
+        captured.clear();
+        path[0] = path[1] = 0;
+    }
+    int direction(int step) const {
+        return (path[step >> 5] >> ((step & 31) * 2)) & 3;
+    }
+    void pushStep(int direction) {
+        path[steps >> 5] |= uint64_t(direction) << ((steps & 31) * 2);
+        ++steps;
+    }
+    void popStep() {
+        --steps;
+        path[steps >> 5] &= ~(uint64_t(3) << ((steps & 31) * 2));
+    }
+    bool empty() const { return steps == 0; }
+    bool isCapture() const { return capture; }
+    bool operator==(const CompactMove& rhs) const {
+        return from == rhs.from && steps == rhs.steps && capture == rhs.capture
+            && path[0] == rhs.path[0] && path[1] == rhs.path[1];
+    }
+    bool operator!=(const CompactMove& rhs) const { return !(*this == rhs); }
+
+    // col is the board width, the square numbering depends on it
+    // fromMove throws MoveBuildError for a sequence that is not a chain of diagonal steps or jumps
+    static CompactMove fromMove(const Move& move, int col);
+    Move toMove(int col) const;
+    static CompactMove fromString(const string& input, int col) { return fromMove(Move(input), col); }
+    string toString(int col) const { return toMove(col).toString(); }
+};
+
+#endif //CHECKER_TEACHER_COMPACTMOVE_H
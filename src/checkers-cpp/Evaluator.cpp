@@ -0,0 +1,131 @@
+//
+// Piece-square evaluation used by the heuristic playouts.
+//
+
+#include "Evaluator.h"
+#include <cmath>
+#include <memory>
+#include <mutex>
+
+constexpr double Evaluator::KING_SCORE;
+constexpr double Evaluator::CENTER_SCORE;
+constexpr double Evaluator::EDGE_SCORE;
+constexpr double Evaluator::DEFENSIVE_SCORE;
+constexpr double Evaluator::MAN_VALUE;
+constexpr double Evaluator::KING_VALUE;
+constexpr double Evaluator::ADVANCE_VALUE;
+constexpr double Evaluator::WIN_SLOPE;
+
+const Evaluator* Evaluator::get(const BoardGeometry* geometry) {
+    static map<const BoardGeometry*, unique_ptr<Evaluator> > cache;
+    static mutex cacheMutex;
+    lock_guard<mutex> lock(cacheMutex);
+    unique_ptr<Evaluator>& entry = cache[geometry];
+    if (!entry) {
+        entry.reset(new Evaluator());
+        Evaluator &e = *entry;
+        int row = geometry->row, col = geometry->col;
+        double scoreMultiplier = 1.0 * (col / 7.0);
+        for (int i = 0; i < row; i++) {
+            for (int j = 0; j < col; j++) {
+                int sq = i * col + j;
+                double distanceToCenter = sqrt(pow(i - row / 2.0, 2) + pow(j - col / 2.0, 2));
+                double base = CENTER_SCORE / (distanceToCenter + 1.0); // closer to the center is better
+                if (j == 0 || j == col - 1) { // pieces on the side edges cannot be captured
+                    base += EDGE_SCORE;
+                }
+                for (int player = 1; player <= 2; player++) {
+                    double score = base;
+                    if ((player == 1 && i == 0) || (player == 2 && i == row - 1)) { // still guarding the back rank
+                        score += DEFENSIVE_SCORE;
+                    }
+                    e.pieceScore[player][0][sq] = scoreMultiplier * score;
+                    e.pieceScore[player][1][sq] = scoreMultiplier * (score + KING_SCORE);
+                    // black starts on row 0 and promotes on the last row, white the other way round
+                    int advanced = player == 1 ? i : row - 1 - i;
+                    e.materialScore[player][0][sq] = MAN_VALUE + ADVANCE_VALUE * advanced / max(1, row - 2);
+                    e.materialScore[player][1][sq] = KING_VALUE;
+                }
+                e.pieceScore[0][0][sq] = e.pieceScore[0][1][sq] = 0;
+                e.materialScore[0][0][sq] = e.materialScore[0][1][sq] = 0;
+            }
+        }
+    }
+    return entry.get();
+}
+
+double Evaluator::sum(const BitBoard &pieces, const BitBoard &kings, int player) const {
+    double total = 0;
+    for (int sq = pieces.first(); sq != -1; sq = pieces.next(sq)) {
+        total += pieceScore[player][kings.test(sq)][sq];
+    }
+    return total;
+}
+
+double Evaluator::material(const Board &board, int player) const {
+    double total = 0;
+    const BitBoard &own = board.pieces(player), &other = board.pieces(3 - player);
+    for (int sq = own.first(); sq != -1; sq = own.next(sq)) {
+        total += materialScore[player][board.kings.test(sq)][sq];
+    }
+    for (int sq = other.first(); sq != -1; sq = other.next(sq)) {
+        total -= materialScore[3 - player][board.kings.test(sq)][sq];
+    }
+    return total;
+}
+
+double Evaluator::winProbability(const Board &board, int player) const {
+    return 1.0 / (1.0 + exp(-WIN_SLOPE * material(board, player)));
+}
+
+double Evaluator::evaluate(const Board &board, int player) const {
+    double blackScore = sum(board.black, board.kings, 1);
+    double whiteScore = sum(board.white, board.kings, 2);
+    return player == 1 ? blackScore - whiteScore : whiteScore - blackScore;
+}
+
+// follows the steps of Board::makeMove: the mover leaves its start square, every jumped piece is removed and a
+// man that reaches the promotion row is crowned and stops there
+double Evaluator::moveDelta(const Board &board, const Move &move, int player) const {
+    const vector<Position> &path = move.seq;
+    int from = board.square(path[0].x, path[0].y);
+    bool king = board.kings.test(from);
+    double delta = -pieceScore[player][king][from];
+    int sq = from;
+    for (size_t t = 0; t + 1 < path.size(); ++t) {
+        const Position &start = path[t];
+        const Position &target = path[t + 1];
+        sq = board.square(target.x, target.y);
+        if (abs(start.x - target.x) == 2) {
+            int captured = board.square((start.x + target.x) / 2, (start.y + target.y) / 2);
+            delta += pieceScore[3 - player][board.kings.test(captured)][captured];
+        }
+        if (board.geometry->promotionRow[player].test(sq) && !king) {
+            king = true;
+            break;
+        }
+    }
+    return delta + pieceScore[player][king][sq];
+}
+
+double Evaluator::moveDelta(const Board &board, const CompactMove &move, int player) const {
+    const BoardGeometry &g = *board.geometry;
+    int sq = move.from;
+    bool king = board.kings.test(sq);
+    double delta = -pieceScore[player][king][sq];
+    for (int i = 0; i < move.steps; ++i) {
+        int d = move.direction(i);
+        if (move.capture) {
+            int captured = g.step[sq][d];
+            delta += pieceScore[3 - player][board.kings.test(captured)][captured];
+            sq = g.jump[sq][d];
+        } else {
+            sq = g.step[sq][d];
+        }
+        if (g.promotionRow[player].test(sq) && !king) {
+            king = true;
+            break;
+        }
+    }
+    return delta + pieceScore[player][king][sq];
+}
@@ -0,0 +1,39 @@
+//
+// Piece-square evaluation used by the heuristic playouts.
+//
+
+#ifndef CHECKER_TEACHER_EVALUATOR_H
+#define CHECKER_TEACHER_EVALUATOR_H
+
+#include "Board.h"
+
+// every piece is worth a precomputed amount for its color, king flag and square: closeness to the center,
+// the side edges, its own back rank and a king bonus, all scaled with the board width
+// tables are built once per board size and shared, like BoardGeometry
+// the material count used to score cut off playouts is separate: men, kings and how far each man has advanced
+class Evaluator {
+public:
+    static constexpr double KING_SCORE = 0.7;
+    static constexpr double CENTER_SCORE = 0.5;
+    static constexpr double EDGE_SCORE = 0.3;
+    static constexpr double DEFENSIVE_SCORE = 0.2;
+    static constexpr double MAN_VALUE = 1.0;
+    static constexpr double KING_VALUE = 1.5;
+    static constexpr double ADVANCE_VALUE = 0.3; // for a man on the row before promotion, less the closer it is to its own back rank
+    static constexpr double WIN_SLOPE = 1.0;     // logistic slope of winProbability, one man ahead is a 73% win
+    static const Evaluator* get(const BoardGeometry* geometry);
+    double pieceValue(int player, bool king, int sq) const { return pieceScore[player][king][sq]; }
+    double evaluate(const Board &board, int player) const; // own pieces minus the opponent's
+    // change of evaluate(board, player) if player made move, computed without applying the move
+    double moveDelta(const Board &board, const Move &move, int player) const;
+    double moveDelta(const Board &board, const CompactMove &move, int player) const;
+    double material(const Board &board, int player) const; // own material minus the opponent's
+    double winProbability(const Board &board, int player) const; // material turned into a chance to win for player
+
+private:
+    double pieceScore[3][2][BITBOARD_MAX_SQUARES]; // [player][king][square]
+    double materialScore[3][2][BITBOARD_MAX_SQUARES]; // [player][king][square]
+    double sum(const BitBoard &pieces, const BitBoard &kings, int player) const;
+};
+
+#endif //CHECKER_TEACHER_EVALUATOR_H
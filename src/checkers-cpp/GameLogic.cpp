@@ -1,6 +1,12 @@
 #include "GameLogic.h"
 
 GameLogic::GameLogic(int col, int row, int p, string mode,int order)
+	: GameLogic(col, row, p, mode, order, SearchConfig())
+{
+}
+
+GameLogic::GameLogic(int col, int row, int p, string mode,int order,const SearchConfig &config)
+	: config(config)
 {
 	this->col = col;
 	this->row = row;
@@ -55,7 +61,10 @@ void GameLogic::Manual()
 
 void GameLogic::TournamentInterface()
 {
-	StudentAI ai(col, row, p);
+	// the opponent's thinking time is used to keep searching our tree
+	SearchConfig tournamentConfig = config;
+	tournamentConfig.ponder = true;
+	StudentAI ai(col, row, p, tournamentConfig);
 	while (true)
 	{
 		string instr;
@@ -69,7 +78,7 @@ void GameLogic::Run()
 {
 	if (mode == "m" or mode == "manual")
 	{
-        AI* studentai = new StudentAI(col, row, p);
+        AI* studentai = new StudentAI(col, row, p, config);
         AI* manualai = new ManualAI(col, row, p);
 		if (order == 1)
         	{
@@ -86,8 +95,8 @@ void GameLogic::Run()
 	}
 	else if (mode == "s" or mode == "self")
 	{
-		AI* studentai = new StudentAI(col, row, p);
-        AI* manualai = new StudentAI(col, row, p);
+		AI* studentai = new StudentAI(col, row, p, config);
+        AI* manualai = new StudentAI(col, row, p, config);
 		if (order == 1)
         	{
             		aiList->push_back(manualai);
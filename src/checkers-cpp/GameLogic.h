@@ -13,8 +13,10 @@ private:
 	int col, row, p,order;
 	string mode;
 	vector<AI*> *aiList;
+	SearchConfig config;
 public:
 	GameLogic(int col,int row,int p,string mode,int order);
+	GameLogic(int col,int row,int p,string mode,int order,const SearchConfig &config);
 	void Manual();
 	void TournamentInterface();
 	void Run();
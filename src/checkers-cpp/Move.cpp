@@ -10,9 +10,12 @@ Move::Move(const Move & move)
     this->seq = move.seq;
 }
 
-Move::Move(const vector<Position> seq)
+Move::Move(Move && move) noexcept : seq(std::move(move.seq))
+{
+}
+
+Move::Move(vector<Position> seq) : seq(std::move(seq))
 {
-    this->seq = seq;
 }
 
 Move::Move(const string & input)
@@ -70,9 +73,9 @@ string Move::toString()
     return result;
 }
 
-bool Move::isCapture()
+bool Move::isCapture() const
 {
     if (this->seq.size()>2)
         return true;
-    return abs(seq[0][0]-seq[1][0]) > 1;
+    return abs(seq[0].x - seq[1].x) > 1;
 }
\ No newline at end of file
@@ -14,11 +14,14 @@ public:
 	vector<Position> seq;
 	Move();
     Move(const Move & move);
-    Move(const vector<Position> seq);
+    Move(Move && move) noexcept;
+    Move(vector<Position> seq);
+    Move& operator=(const Move & move) = default;
+    Move& operator=(Move && move) noexcept = default;
     Move(const string & input);
     vector<string> split(string input,string delimiter);
     string toString();
-    bool isCapture();
+    bool isCapture() const;
 };
 
 class MoveBuildError : public std::exception
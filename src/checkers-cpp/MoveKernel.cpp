@@ -0,0 +1,225 @@
+//
+// Move generation kernels specialized for the common board sizes.
+//
+
+#include "MoveKernel.h"
+#include <type_traits>
+
+namespace {
+
+// compile time index lists, std::index_sequence needs C++14
+template <int... I> struct Indices {};
+template <int N, int... I> struct MakeIndices : MakeIndices<N - 1, N - 1, I...> {};
+template <int... I> struct MakeIndices<0, I...> { typedef Indices<I...> type; };
+
+// BoardGeometry's direction numbering, 0 = (1,-1), 1 = (1,1), 2 = (-1,-1), 3 = (-1,1)
+constexpr int dirRow(int d) { return d < 2 ? 1 : -1; }
+constexpr int dirCol(int d) { return d & 1 ? 1 : -1; }
+
+// the square distance steps away from sq in direction d, -1 if that is off the board
+template <int COL, int ROW>
+constexpr int target(int sq, int d, int distance) {
+    return sq / COL + distance * dirRow(d) >= 0 && sq / COL + distance * dirRow(d) < ROW
+        && sq % COL + distance * dirCol(d) >= 0 && sq % COL + distance * dirCol(d) < COL
+        ? sq + distance * (dirRow(d) * COL + dirCol(d)) : -1;
+}
+
+// the squares from which target(sq, d, distance) is on the board
+template <class Mask, int COL, int ROW>
+constexpr Mask onBoard(int d, int distance, int sq) {
+    return sq == COL * ROW ? Mask(0)
+        : (target<COL, ROW>(sq, d, distance) >= 0 ? Mask(1) << sq : Mask(0)) | onBoard<Mask, COL, ROW>(d, distance, sq + 1);
+}
+
+// BoardGeometry's step and jump tables as constants, entry sq * 4 + d
+template <int COL, int ROW, class Seq> struct Tables;
+template <int COL, int ROW, int... I>
+struct Tables<COL, ROW, Indices<I...> > {
+    static constexpr signed char step[sizeof...(I)] = {target<COL, ROW>(I / 4, I % 4, 1)...};
+    static constexpr signed char jump[sizeof...(I)] = {target<COL, ROW>(I / 4, I % 4, 2)...};
+};
+template <int COL, int ROW, int... I>
+constexpr signed char Tables<COL, ROW, Indices<I...> >::step[sizeof...(I)];
+template <int COL, int ROW, int... I>
+constexpr signed char Tables<COL, ROW, Indices<I...> >::jump[sizeof...(I)];
+
+inline void load(const BitBoard& b, uint64_t& m) { m = b.w[0]; }
+inline void load(const BitBoard& b, unsigned __int128& m) { m = b.w[0] | (unsigned __int128)b.w[1] << 64; }
+inline void store(uint64_t m, BitBoard& b) {
+    b.clear();
+    b.w[0] = m;
+}
+inline void store(unsigned __int128 m, BitBoard& b) {
+    b.clear();
+    b.w[0] = (uint64_t)m;
+    b.w[1] = (uint64_t)(m >> 64);
+}
+inline int lowest(uint64_t m) { return __builtin_ctzll(m); }
+inline int lowest(unsigned __int128 m) {
+    uint64_t low = (uint64_t)m;
+    return low ? __builtin_ctzll(low) : 64 + __builtin_ctzll((uint64_t)(m >> 64));
+}
+
+// the same search as Board::generateMoves on one native integer per mask. The pieces that can capture are
+// found for all pieces at once with shifts, so the jump search only runs for those, and simple moves are only
+// generated when there are none.
+template <int COL, int ROW>
+struct FixedKernel {
+    static const int SQUARES = COL * ROW;
+    static_assert(SQUARES <= 127, "squares must fit the signed char tables");
+    typedef typename conditional<(SQUARES <= 64), uint64_t, unsigned __int128>::type Mask;
+    typedef Tables<COL, ROW, typename MakeIndices<SQUARES * 4>::type> T;
+
+    template <int D, int DISTANCE>
+    struct Direction {
+        static constexpr int SHIFT = DISTANCE * (dirRow(D) * COL + dirCol(D));
+        static constexpr Mask ON_BOARD = onBoard<Mask, COL, ROW>(D, DISTANCE, 0);
+        // bit sq of the result is bit sq + SHIFT of m, for the squares where that is on the board
+        static Mask from(Mask m) { return ON_BOARD & (SHIFT > 0 ? m >> (SHIFT > 0 ? SHIFT : 0) : m << (SHIFT > 0 ? 0 : -SHIFT)); }
+    };
+
+    template <int D>
+    static Mask capturersIn(Mask pieces, Mask enemies, Mask empty) {
+        return pieces & Direction<D, 1>::from(enemies) & Direction<D, 2>::from(empty);
+    }
+    template <int D>
+    static Mask moversIn(Mask pieces, Mask empty) {
+        return pieces & Direction<D, 1>::from(empty);
+    }
+
+    // men of black move in directions 0 and 1, men of white in 2 and 3, kings in all four
+    static Mask capturers(int player, Mask own, Mask kings, Mask enemies, Mask empty) {
+        Mask down = player == 1 ? own : own & kings;
+        Mask up = player == 1 ? own & kings : own;
+        return capturersIn<0>(down, enemies, empty) | capturersIn<1>(down, enemies, empty)
+            | capturersIn<2>(up, enemies, empty) | capturersIn<3>(up, enemies, empty);
+    }
+
+    static void generate(const Board& board, int player, MoveList& moves, bool capturesOnly) {
+        moves.clear();
+        if (player != 1 && player != 2)
+            return;
+        Mask own, enemies, kings;
+        load(board.pieces(player), own);
+        load(board.pieces(3 - player), enemies);
+        load(board.kings, kings);
+        Mask occupied = own | enemies;
+        Mask jumpers = capturers(player, own, kings, enemies, ~occupied);
+        if (jumpers) {
+            for (Mask rest = jumpers; rest; rest &= rest - 1) {
+                int sq = lowest(rest);
+                jumpSearch(sq, player, (kings >> sq) & 1 ? 4 : 2, occupied & ~(Mask(1) << sq), enemies, moves);
+                moves.closeGroup();
+            }
+            return;
+        }
+        if (capturesOnly)
+            return;
+        const int* order = BoardGeometry::exploreOrder[player];
+        for (Mask rest = own; rest; rest &= rest - 1) {
+            int sq = lowest(rest);
+            int dirCount = (kings >> sq) & 1 ? 4 : 2;
+            int begin = moves.size();
+            for (int i = 0; i < dirCount; ++i) {
+                int to = T::step[sq * 4 + order[i]];
+                if (to >= 0 && !((occupied >> to) & 1)) {
+                    CompactMove simple;
+                    simple.from = sq;
+                    simple.to = to;
+                    simple.pushStep(order[i]);
+                    moves.push(simple);
+                }
+            }
+            if (moves.size() > begin)
+                moves.closeGroup();
+        }
+    }
+
+    // Board::jumpSearch, the captured squares are the enemies missing from enemiesLeft
+    static void jumpSearch(int start, int player, int dirCount, Mask occupied, Mask enemies, MoveList& moves) {
+        struct Frame {
+            int sq;
+            int next;
+            bool extended;
+        };
+        const int* order = BoardGeometry::exploreOrder[player];
+        Frame stack[CompactMove::MAX_STEPS + 1];
+        int top = 0;
+        stack[0] = Frame{start, 0, false};
+        Mask enemiesLeft = enemies;
+        CompactMove current;
+        current.from = start;
+        current.capture = true;
+        while (true) {
+            Frame& frame = stack[top];
+            if (frame.next < dirCount && top < CompactMove::MAX_STEPS) {
+                int d = order[frame.next++];
+                int over = T::step[frame.sq * 4 + d];
+                int land = T::jump[frame.sq * 4 + d];
+                if (land < 0 || !((enemiesLeft >> over) & 1) || ((occupied >> land) & 1))
+                    continue;
+                frame.extended = true;
+                enemiesLeft ^= Mask(1) << over;
+                occupied ^= Mask(1) << over;
+                current.pushStep(d);
+                stack[++top] = Frame{land, 0, false};
+                continue;
+            }
+            if (top == 0)
+                return;
+            if (!frame.extended) {
+                current.to = frame.sq;
+                store(enemies & ~enemiesLeft, current.captured);
+                moves.push(current);
+            }
+            --top;
+            int over = T::step[stack[top].sq * 4 + current.direction(current.steps - 1)];
+            current.popStep();
+            enemiesLeft |= Mask(1) << over;
+            occupied |= Mask(1) << over;
+        }
+    }
+
+    static bool hasAnyLegalMove(const Board& board, int player) {
+        if (player != 1 && player != 2)
+            return false;
+        Mask own, enemies, kings;
+        load(board.pieces(player), own);
+        load(board.pieces(3 - player), enemies);
+        load(board.kings, kings);
+        Mask empty = ~(own | enemies);
+        Mask down = player == 1 ? own : own & kings;
+        Mask up = player == 1 ? own & kings : own;
+        return (moversIn<0>(down, empty) | moversIn<1>(down, empty) | moversIn<2>(up, empty) | moversIn<3>(up, empty))
+            || capturers(player, own, kings, enemies, empty);
+    }
+};
+
+void genericGenerate(const Board& board, int player, MoveList& moves, bool capturesOnly) {
+    if (capturesOnly)
+        board.getCaptureMoves(player, moves);
+    else
+        board.getAllPossibleMoves(player, moves);
+}
+
+bool genericHasAnyLegalMove(const Board& board, int player) {
+    return board.hasAnyLegalMove(player);
+}
+
+}
+
+const MoveKernel MoveKernel::generic = {"generic", genericGenerate, genericHasAnyLegalMove};
+
+// the sizes tournaments are played on, anything else takes the generic kernel
+const MoveKernel* MoveKernel::get(int col, int row) {
+    static const MoveKernel kernel7x7 = {"7x7", FixedKernel<7, 7>::generate, FixedKernel<7, 7>::hasAnyLegalMove};
+    static const MoveKernel kernel8x8 = {"8x8", FixedKernel<8, 8>::generate, FixedKernel<8, 8>::hasAnyLegalMove};
+    static const MoveKernel kernel10x10 = {"10x10", FixedKernel<10, 10>::generate, FixedKernel<10, 10>::hasAnyLegalMove};
+    if (col == 7 && row == 7)
+        return &kernel7x7;
+    if (col == 8 && row == 8)
+        return &kernel8x8;
+    if (col == 10 && row == 10)
+        return &kernel10x10;
+    return &generic;
+}
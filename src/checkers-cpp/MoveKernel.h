@@ -0,0 +1,24 @@
+//
+// Move generation kernels specialized for the common board sizes.
+//
+
+#ifndef CHECKER_TEACHER_MOVEKERNEL_H
+#define CHECKER_TEACHER_MOVEKERNEL_H
+
+#include "Board.h"
+
+// the search's move generation entry points for one board size. get() returns a kernel compiled for that
+// (col,row), where the whole board fits in one native integer and the step and jump tables are compile time
+// constants, or the generic kernel that forwards to Board. Every kernel gives exactly the moves, groups and
+// order of Board::getAllPossibleMoves.
+struct MoveKernel {
+    const char* name;
+    // fills moves like Board::getAllPossibleMoves(player, MoveList&), or Board::getCaptureMoves for capturesOnly
+    void (*generate)(const Board& board, int player, MoveList& moves, bool capturesOnly);
+    bool (*hasAnyLegalMove)(const Board& board, int player);
+
+    static const MoveKernel generic;
+    static const MoveKernel* get(int col, int row);
+};
+
+#endif //CHECKER_TEACHER_MOVEKERNEL_H
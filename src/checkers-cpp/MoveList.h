@@ -0,0 +1,56 @@
+//
+// Fixed-capacity move buffer filled by Board's move generator.
+//
+
+#ifndef CHECKER_TEACHER_MOVELIST_H
+#define CHECKER_TEACHER_MOVELIST_H
+
+#include "CompactMove.h"
+
+// the legal moves of one position grouped per piece, in the order of getAllPossibleMoves: group g holds
+// moves[groupStart[g]] .. moves[groupStart[g + 1] - 1]. Nothing is allocated, so a list can be reused for
+// every ply of a playout. A position with more than CAPACITY moves keeps the first CAPACITY and sets overflow.
+struct MoveList {
+    static const int CAPACITY = 512;
+    static const int MAX_GROUPS = BITBOARD_MAX_SQUARES / 2; // one per piece
+    CompactMove moves[CAPACITY];
+    int groupStart[MAX_GROUPS + 1];
+    int count = 0;
+    int groups = 0;
+    bool overflow = false;
+
+    void clear() {
+        count = 0;
+        groups = 0;
+        groupStart[0] = 0;
+        overflow = false;
+    }
+    int size() const { return count; }
+    bool empty() const { return count == 0; }
+    const CompactMove& operator[](int i) const { return moves[i]; }
+    int groupSize(int g) const { return groupStart[g + 1] - groupStart[g]; }
+    const CompactMove& inGroup(int g, int i) const { return moves[groupStart[g] + i]; }
+
+    // used by the generator
+    void push(const CompactMove& move) {
+        if (count < CAPACITY)
+            moves[count++] = move;
+        else
+            overflow = true;
+    }
+    void resize(int n) { count = n; }
+    void erase(int begin, int end) { // removes moves[begin, end), later moves shift down
+        for (int i = end; i < count; ++i)
+            moves[begin + i - end] = moves[i];
+        count -= end - begin;
+    }
+    void closeGroup() { // the moves pushed since the last group form a new group
+        groupStart[++groups] = count;
+    }
+    void dropGroups() { // forget the groups closed so far, their moves must be erased by the caller
+        groups = 0;
+        groupStart[0] = 0;
+    }
+};
+
+#endif //CHECKER_TEACHER_MOVELIST_H
@@ -0,0 +1,91 @@
+//
+// Fixed budget bump allocator for search trees.
+//
+
+#ifndef CHECKER_TEACHER_NODEARENA_H
+#define CHECKER_TEACHER_NODEARENA_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Everything a tree holds (its nodes and whatever they point to) is placed one after another in a single block
+// reserved up front, so allocation is a pointer bump, the budget bounds the whole tree and the arena is released
+// at once by resetting the cursor. Nothing placed here is ever destroyed, so T must be trivially destructible and
+// other objects must not own memory elsewhere.
+// Every allocation takes a whole number of GRANULE bytes, aligned to GRANULE, so the space a set of objects needs
+// does not depend on the order they are placed in: a subtree always fits an arena the size of its tree.
+// create() and allocate() may be called from several search threads, release() and swap() only while no search
+// is running.
+template <class T>
+class NodeArena {
+public:
+    static const size_t GRANULE = 64;
+    static_assert(std::is_trivially_destructible<T>::value, "the arena never runs destructors");
+    static_assert(alignof(T) <= GRANULE, "objects are aligned to GRANULE at most");
+
+    explicit NodeArena(size_t megabytes)
+        : bytes(megabytes * 1024 * 1024 / GRANULE * GRANULE), used(0), objects(0),
+          storage(new char[bytes + GRANULE]) {
+        uintptr_t address = reinterpret_cast<uintptr_t>(storage.get());
+        base = reinterpret_cast<char*>((address + GRANULE - 1) / GRANULE * GRANULE);
+    }
+    NodeArena(const NodeArena&) = delete;
+    NodeArena& operator=(const NodeArena&) = delete;
+
+    // raw memory for size bytes, nullptr once the budget is used up
+    void* allocate(size_t size) {
+        size_t rounded = (std::max<size_t>(size, 1) + GRANULE - 1) / GRANULE * GRANULE;
+        size_t offset = used.fetch_add(rounded, std::memory_order_relaxed);
+        if (offset + rounded > bytes) {
+            return nullptr;
+        }
+        return base + offset;
+    }
+
+    template <class... Args>
+    T* create(Args&&... args) {
+        void* memory = allocate(sizeof(T));
+        if (memory == nullptr) {
+            return nullptr;
+        }
+        objects.fetch_add(1, std::memory_order_relaxed);
+        return new (memory) T(std::forward<Args>(args)...);
+    }
+
+    // frees everything in the arena, a cursor reset
+    void release() {
+        used.store(0);
+        objects.store(0);
+    }
+
+    void swap(NodeArena& other) {
+        size_t otherUsed = other.used.load(), otherObjects = other.objects.load();
+        other.used.store(used.load());
+        other.objects.store(objects.load());
+        used.store(otherUsed);
+        objects.store(otherObjects);
+        std::swap(bytes, other.bytes);
+        std::swap(storage, other.storage);
+        std::swap(base, other.base);
+    }
+
+    size_t size() const { return objects.load(); } // objects made by create()
+    size_t bytesUsed() const { return std::min(used.load(), bytes); }
+    size_t capacity() const { return bytes; }
+    bool full() const { return used.load() >= bytes; }
+
+private:
+    size_t bytes;
+    std::atomic<size_t> used;
+    std::atomic<size_t> objects;
+    std::unique_ptr<char[]> storage;
+    char* base;
+};
+
+#endif //CHECKER_TEACHER_NODEARENA_H
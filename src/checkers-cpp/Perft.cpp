@@ -0,0 +1,316 @@
+//
+// Move generation benchmark and validator.
+//
+// usage: perft {col} {row} {p} {depth} [validate] [kings] [fast] [generic]
+//   counts the leaf nodes of the move tree to the given depth with Board::getAllPossibleMoves/makeMove/Undo
+//   and prints node counts and nodes/sec per depth. In validate mode every node is also checked against
+//   the reference generator (Checker::getPossibleMoves + binary_tree_traversal), the incremental hash and
+//   piece counts must equal a full recomputation and makeMove/Undo must restore the position exactly. The
+//   CompactMove generator must give the same moves, each must survive the Move and string round trips, and
+//   making it on a board without history must reach the same position as making the Move, and be undone
+//   exactly on a board with history. The MoveList generator must give the same groups, the captures only
+//   variant the same list or nothing, the count its size and hasAnyLegalMove whether it is empty.
+//   kings starts from a king endgame instead of the opening, where multi-jump trees are largest.
+//   fast counts with the MoveKernel for the size and copy-make on history free boards, the search's own path;
+//   generic makes it use the generic kernel, to measure what the specialized one gains. validate also checks
+//   the specialized kernel against the MoveList generator.
+//
+
+#include "Board.h"
+#include "MoveKernel.h"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+using namespace std::chrono;
+
+// the original grid based generator, kept as the reference the board generator must match
+static vector<vector<Move> > referenceMoves(Board& board, int player)
+{
+    vector<vector<Move> > temp;
+    string color = player == 1 ? "B" : "W";
+    for (int i = 0; i < board.row; i++) {
+        for (int j = 0; j < board.col; j++) {
+            Checker checker = board.getChecker(i, j);
+            if (checker.color == color) {
+                vector<Move> moves;
+                moves = checker.getPossibleMoves(&board);
+                if (!moves.empty())
+                    temp.push_back(moves);
+            }
+        }
+    }
+    bool hasCapture = false;
+    vector<vector<Move> > result;
+    int cursorToResult = 0;
+    for (size_t cursorToTemp = 0; cursorToTemp < temp.size(); ++cursorToTemp)
+    {
+        vector<Move> VectorI;
+        result.push_back(VectorI);
+        for (size_t j = 0; j < temp[cursorToTemp].size(); ++j)
+        {
+            if (! hasCapture)
+            {
+                if (temp[cursorToTemp][j].isCapture())
+                {
+                    hasCapture = true;
+                    result.clear();
+                    vector<Move> firstVector;
+                    firstVector.push_back(temp[cursorToTemp][j]);
+                    result.push_back(firstVector);
+                    cursorToResult = 0;
+                }
+                else{
+                    result[cursorToResult].push_back(temp[cursorToTemp][j]);
+                }
+            }
+            else{
+                if (temp[cursorToTemp][j].isCapture())
+                {
+                    result[cursorToResult].push_back(temp[cursorToTemp][j]);
+                }
+            }
+        }
+        if (result[cursorToResult].size() == 0 )
+        {
+            result.erase(result.begin() + cursorToResult);
+            --cursorToResult;
+        }
+        ++cursorToResult;
+    }
+    return result;
+}
+
+static string movesToString(vector<vector<Move> >& moves)
+{
+    string result;
+    for (size_t i = 0; i < moves.size(); ++i)
+    {
+        result += "[";
+        for (size_t j = 0; j < moves[i].size(); ++j)
+        {
+            result += moves[i][j].toString();
+            if (j != moves[i].size() - 1)
+                result += ", ";
+        }
+        result += "]";
+    }
+    return result;
+}
+
+static bool sameState(const Board& a, const Board& b)
+{
+    return a.black == b.black && a.white == b.white && a.kings == b.kings
+        && a.blackCount == b.blackCount && a.whiteCount == b.whiteCount
+        && a.blackKings == b.blackKings && a.whiteKings == b.whiteKings
+        && a.tieCount == b.tieCount && a.sideToMove == b.sideToMove && a.hashKey == b.hashKey;
+}
+
+static void fail(Board& board, int player, const string& reason, const string& expected, const string& actual)
+{
+    cout << "MISMATCH: " << reason << " (player " << player << " to move)" << endl;
+    board.showBoard();
+    cout << "expected: " << expected << endl;
+    cout << "actual:   " << actual << endl;
+    exit(1);
+}
+
+static void validateCompact(Board& board, int player, vector<vector<Move> >& moves)
+{
+    vector<CompactMove> compact;
+    board.getAllPossibleMoves(player, compact);
+    size_t k = 0;
+    for (size_t i = 0; i < moves.size(); ++i)
+    {
+        for (size_t j = 0; j < moves[i].size(); ++j, ++k)
+        {
+            string expected = moves[i][j].toString();
+            if (k >= compact.size())
+                fail(board, player, "compact generator has fewer moves", expected, "");
+            if (compact[k].toString(board.col) != expected)
+                fail(board, player, "compact move differs", expected, compact[k].toString(board.col));
+            if (CompactMove::fromMove(moves[i][j], board.col) != compact[k]
+                || CompactMove::fromString(expected, board.col) != compact[k])
+                fail(board, player, "compact move does not round trip", expected, compact[k].toString(board.col));
+            Board viaMove = board;
+            viaMove.makeMove(moves[i][j], player);
+            Board viaCompact;
+            viaCompact.copyState(board);
+            viaCompact.recordHistory = false;
+            viaCompact.makeMove(compact[k], player);
+            if (!sameState(viaMove, viaCompact))
+                fail(board, player, "compact makeMove reaches a different position", expected, compact[k].toString(board.col));
+            Board undone = board;
+            undone.makeMove(compact[k], player);
+            undone.Undo();
+            if (!sameState(undone, board))
+                fail(board, player, "Undo of a compact move did not restore the position", expected, compact[k].toString(board.col));
+        }
+    }
+    if (k != compact.size())
+        fail(board, player, "compact generator has more moves", "", compact[k].toString(board.col));
+
+    static MoveList list, captures;
+    board.getAllPossibleMoves(player, list);
+    board.getCaptureMoves(player, captures);
+    string expected = movesToString(moves);
+    string actual;
+    for (int g = 0; g < list.groups; ++g)
+    {
+        actual += "[";
+        for (int i = 0; i < list.groupSize(g); ++i)
+            actual += (i ? ", " : "") + list.inGroup(g, i).toString(board.col);
+        actual += "]";
+    }
+    if (list.overflow || actual != expected || list.groupStart[list.groups] != list.size())
+        fail(board, player, "MoveList differs", expected, actual);
+    bool hasCapture = !list.empty() && list[0].capture;
+    if (captures.size() != (hasCapture ? list.size() : 0))
+        fail(board, player, "captures only list differs", to_string(hasCapture ? list.size() : 0), to_string(captures.size()));
+    for (int i = 0; i < captures.size(); ++i)
+        if (captures[i] != list[i])
+            fail(board, player, "captures only list differs", list[i].toString(board.col), captures[i].toString(board.col));
+    if (board.countPossibleMoves(player) != list.size())
+        fail(board, player, "countPossibleMoves differs", to_string(list.size()), to_string(board.countPossibleMoves(player)));
+    if (board.hasAnyLegalMove(player) != !list.empty())
+        fail(board, player, "hasAnyLegalMove differs", to_string(!list.empty()), to_string(board.hasAnyLegalMove(player)));
+
+    const MoveKernel* kernel = MoveKernel::get(board.col, board.row);
+    static MoveList fromKernel;
+    for (int capturesOnly = 0; capturesOnly < 2; ++capturesOnly)
+    {
+        const MoveList& expectedList = capturesOnly ? captures : list;
+        kernel->generate(board, player, fromKernel, capturesOnly != 0);
+        bool same = fromKernel.size() == expectedList.size() && fromKernel.groups == (capturesOnly && captures.empty() ? 0 : list.groups);
+        for (int i = 0; same && i < fromKernel.size(); ++i)
+            same = fromKernel[i] == expectedList[i] && fromKernel[i].to == expectedList[i].to
+                && fromKernel[i].captured == expectedList[i].captured;
+        for (int g = 0; same && g <= fromKernel.groups; ++g)
+            same = fromKernel.groupStart[g] == list.groupStart[g];
+        if (!same)
+            fail(board, player, string(kernel->name) + " kernel differs" + (capturesOnly ? " for captures only" : ""), "", "");
+    }
+    if (kernel->hasAnyLegalMove(board, player) != !list.empty())
+        fail(board, player, string(kernel->name) + " kernel hasAnyLegalMove differs", to_string(!list.empty()), "");
+}
+
+static long long perft(Board& board, int player, int depth, bool validate)
+{
+    if (depth == 0)
+        return 1;
+    vector<vector<Move> > moves = board.getAllPossibleMoves(player);
+    if (validate)
+    {
+        vector<vector<Move> > expected = referenceMoves(board, player);
+        string expectedString = movesToString(expected);
+        string actualString = movesToString(moves);
+        if (expectedString != actualString)
+            fail(board, player, "move lists differ", expectedString, actualString);
+        if (board.hashKey != board.computeHash())
+            fail(board, player, "incremental hash differs from a full recomputation", to_string(board.computeHash()), to_string(board.hashKey));
+        if (board.blackCount != board.black.count() || board.whiteCount != board.white.count()
+            || board.blackKings != (board.black & board.kings).count() || board.whiteKings != (board.white & board.kings).count())
+            fail(board, player, "incremental piece counts differ from the masks", "", "");
+        validateCompact(board, player, moves);
+    }
+    long long nodes = 0;
+    for (size_t i = 0; i < moves.size(); ++i)
+    {
+        for (size_t j = 0; j < moves[i].size(); ++j)
+        {
+            if (depth == 1 && !validate)
+            {
+                ++nodes;
+                continue;
+            }
+            Board before = board;
+            board.makeMove(moves[i][j], player);
+            nodes += perft(board, player == 1 ? 2 : 1, depth - 1, validate);
+            board.Undo();
+            if (validate && !sameState(before, board))
+                fail(board, player, "Undo did not restore the position", "", moves[i][j].toString());
+        }
+    }
+    return nodes;
+}
+
+static long long fastPerft(const MoveKernel* kernel, const Board& board, int player, int depth)
+{
+    static MoveList lists[64];
+    MoveList& moves = lists[depth];
+    Board child;
+    child.recordHistory = false;
+    kernel->generate(board, player, moves, false);
+    if (depth == 1)
+        return moves.size();
+    long long nodes = 0;
+    for (int i = 0; i < moves.size(); ++i)
+    {
+        child.copyState(board);
+        child.makeMove(moves[i], player);
+        nodes += fastPerft(kernel, child, player == 1 ? 2 : 1, depth - 1);
+    }
+    return nodes;
+}
+
+// every piece of the opening is crowned and every second one removed, leaving gaps for long jump chains
+static void setupKingEndgame(Board& board)
+{
+    int seen = 0;
+    for (int sq = 0; sq < board.col * board.row; ++sq)
+    {
+        int piece = board.black.test(sq) ? 1 : board.white.test(sq) ? 2 : 0;
+        if (piece == 0)
+            continue;
+        board.removePiece(sq);
+        if (seen++ % 2 == 0)
+            board.placePiece(sq, piece, true);
+    }
+    board.blackCount = board.black.count();
+    board.whiteCount = board.white.count();
+    board.blackKings = board.blackCount;
+    board.whiteKings = board.whiteCount;
+    board.hashKey = board.computeHash();
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 5)
+    {
+        cout << "usage: perft {col} {row} {p} {depth} [validate] [kings] [fast] [generic]" << endl;
+        return 0;
+    }
+    int col = atoi(argv[1]);
+    int row = atoi(argv[2]);
+    int p = atoi(argv[3]);
+    int depth = atoi(argv[4]);
+    bool validate = false, kings = false, fast = false, generic = false;
+    for (int i = 5; i < argc; ++i)
+    {
+        validate = validate || strcmp(argv[i], "validate") == 0 || strcmp(argv[i], "v") == 0;
+        kings = kings || strcmp(argv[i], "kings") == 0;
+        fast = fast || strcmp(argv[i], "fast") == 0;
+        generic = generic || strcmp(argv[i], "generic") == 0;
+    }
+
+    Board board(col, row, p);
+    board.initializeGame();
+    if (kings)
+        setupKingEndgame(board);
+    board.showBoard();
+    const MoveKernel* kernel = generic ? &MoveKernel::generic : MoveKernel::get(col, row);
+    if (fast)
+        cout << "kernel " << kernel->name << endl;
+    for (int d = 1; d <= depth && d < 64; ++d)
+    {
+        auto start = high_resolution_clock::now();
+        long long nodes = fast ? fastPerft(kernel, board, 1, d) : perft(board, 1, d, validate);
+        double seconds = duration_cast<duration<double> >(high_resolution_clock::now() - start).count();
+        cout << "depth " << setw(2) << d << "  nodes " << setw(12) << nodes
+             << "  time " << fixed << setprecision(3) << seconds << "s"
+             << "  nodes/sec " << setprecision(0) << (seconds > 0 ? nodes / seconds : 0) << endl;
+    }
+    if (validate)
+        cout << "validate: all nodes match the reference generator" << endl;
+    return 0;
+}
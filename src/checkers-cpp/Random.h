@@ -0,0 +1,61 @@
+//
+// Small, fast pseudo random generator for the search.
+//
+
+#ifndef CHECKER_TEACHER_RANDOM_H
+#define CHECKER_TEACHER_RANDOM_H
+
+#include <cstdint>
+
+// one splitmix64 step, used to expand a seed and to derive independent seeds from (seed, stream) pairs
+inline uint64_t splitMix64(uint64_t &state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// xoshiro256**: 32 bytes of state, no locking, so every search thread owns one
+// the same seed gives the same sequence on every platform
+class Xoshiro256 {
+public:
+    explicit Xoshiro256(uint64_t seed = 0) {
+        reseed(seed);
+    }
+    void reseed(uint64_t seed) {
+        for (int i = 0; i < 4; ++i)
+            s[i] = splitMix64(seed);
+    }
+    uint64_t next() {
+        uint64_t result = rotl(s[1] * 5, 7) * 9;
+        uint64_t t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl(s[3], 45);
+        return result;
+    }
+    // uniform in [0, n) without the bias of next() % n (Lemire's multiply and reject), n must be > 0
+    uint32_t below(uint32_t n) {
+        uint64_t m = (next() >> 32) * n;
+        uint32_t low = (uint32_t)m;
+        if (low < n) {
+            uint32_t threshold = (0u - n) % n;
+            while (low < threshold) {
+                m = (next() >> 32) * n;
+                low = (uint32_t)m;
+            }
+        }
+        return (uint32_t)(m >> 32);
+    }
+
+private:
+    uint64_t s[4];
+    static uint64_t rotl(uint64_t x, int k) {
+        return (x << k) | (x >> (64 - k));
+    }
+};
+
+#endif //CHECKER_TEACHER_RANDOM_H
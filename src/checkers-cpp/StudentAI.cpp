@@ -1,4 +1,11 @@
 #include "StudentAI.h"
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <climits>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 //The following part should be completed by students.
 //The students can modify anything except the class name and exisiting functions and varibles.
@@ -6,74 +13,294 @@
 // interactive MCTS website: https://vgarciasc.github.io/mcts-viz/
 // MCTS algorithm explained: https://gibberblot.github.io/rl-notes/single-agent/mcts.html
 
-MCTS::MCTS(Node* root, Board &board, int player) {
+SearchConfig SearchConfig::parse(int argc, char *argv[], int first) {
+    SearchConfig config;
+    for (int i = first; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--threads") == 0 && hasValue) {
+            config.threads = max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--virtual-loss") == 0 && hasValue) {
+            config.virtualLoss = max(0, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--move-seconds") == 0 && hasValue) {
+            config.moveSeconds = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--heuristic-playouts") == 0 && hasValue) {
+            config.heuristicPercent = min(100, max(0, atoi(argv[++i])));
+        } else if (strcmp(argv[i], "--seed") == 0 && hasValue) {
+            config.seed = strtoull(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--iterations") == 0 && hasValue) {
+            config.iterations = max(0, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--total-seconds") == 0 && hasValue) {
+            config.totalSeconds = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--parallel") == 0 && hasValue) {
+            config.rootParallel = strcmp(argv[++i], "root") == 0;
+        } else if (strcmp(argv[i], "--tree-mb") == 0 && hasValue) {
+            config.treeMegabytes = max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--board-interval") == 0 && hasValue) {
+            config.boardInterval = max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--rave") == 0 && hasValue) {
+            config.raveEquivalence = max(0, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--playout-depth") == 0 && hasValue) {
+            config.playoutDepth = max(-1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--tt-mb") == 0 && hasValue) {
+            config.tableMegabytes = max(1, atoi(argv[++i]));
+        } else {
+            cerr << "Unknown option " << argv[i] << endl;
+        }
+    }
+    return config;
+}
+
+// one generator per search thread so threads do not contend on rand(), runMCTS seeds it for each search
+static thread_local Xoshiro256 threadRandom;
+
+// uniform random index in [0, n)
+static int randomIndex(int n) {
+    return threadRandom.below(n);
+}
+
+// spin lock held while a thread initializes a node or appends a child to it
+class ExpansionGuard {
+public:
+    explicit ExpansionGuard(Node *node) : node(node) {
+        while (node->expansionLock.exchange(true, memory_order_acquire)) {
+            this_thread::yield();
+        }
+    }
+    ~ExpansionGuard() {
+        node->expansionLock.store(false, memory_order_release);
+    }
+private:
+    Node *node;
+};
+
+Node::Node(Node* parent, uint64_t hashKey, int player, Board* board)
+    : parent(parent), player(player), hashKey(hashKey), ply(parent != nullptr ? parent->ply + 1 : 0), board(board) {
+}
+
+Node::Node(Node&& other) : parent(other.parent), childCount(other.childCount.load()), children(other.children),
+                           unvisitedCount(other.unvisitedCount.load()), slot(other.slot), player(other.player),
+                           initialized(other.initialized), ownProven(other.ownProven.load()), ownWins(other.ownWins.load()),
+                           ownVisits(other.ownVisits.load()), hashKey(other.hashKey), ply(other.ply), board(other.board) {
+}
+
+size_t ChildBlock::bytes(int count) {
+    return count * (3 * sizeof(atomic<double>) + sizeof(Node*) + sizeof(CompactMove) + 4 * sizeof(atomic<int>) + sizeof(atomic<signed char>));
+}
+
+void ChildBlock::moveTo(char *storage) {
+    memcpy(storage, this->storage, bytes(count));
+    this->storage = storage;
+}
+
+void ChildBlock::assign(char *storage, const CompactMove *moves, int count) {
+    this->storage = storage;
+    this->count = count;
+    for (int i = 0; i < count; i++) {
+        new (wins() + i) atomic<double>(0);
+        new (raveWins() + i) atomic<double>(0);
+        new (ttWins() + i) atomic<double>(0);
+        nodes()[i] = nullptr;
+        new (this->moves() + i) CompactMove(moves[i]);
+        new (visits() + i) atomic<int>(0);
+        new (virtualLoss() + i) atomic<int>(0);
+        new (raveVisits() + i) atomic<int>(0);
+        new (ttVisits() + i) atomic<int>(0);
+        new (proven() + i) atomic<signed char>(Node::UNPROVEN);
+    }
+}
+
+static void atomicAdd(atomic<double> &total, double value) {
+    double current = total.load(memory_order_relaxed);
+    while (!total.compare_exchange_weak(current, current + value, memory_order_relaxed)) {
+    }
+}
+
+void Node::addWins(double score) {
+    atomicAdd(wins(), score);
+}
+
+// the moves of one iteration for the AMAF statistics, per player as from * squares + to, so a capture is known by
+// where it starts and ends. Each iteration gets a new stamp instead of clearing the tables.
+struct AmafMoves {
+    vector<uint32_t> stamp[3];
+    uint32_t current = 0;
+    int squares = 0;
+    void begin(int squares) {
+        if (this->squares != squares || ++current == 0) {
+            this->squares = squares;
+            for (int player = 1; player <= 2; player++) {
+                stamp[player].assign(squares * squares, 0);
+            }
+            current = 1;
+        }
+    }
+    void add(int player, const CompactMove &move) { stamp[player][move.from * squares + move.to] = current; }
+    bool contains(int player, const CompactMove &move) const { return stamp[player][move.from * squares + move.to] == current; }
+};
+static thread_local AmafMoves amafMoves;
+
+Board* MCTS::storeBoard(TreeArena &arena, const Board &board) {
+    void *memory = arena.allocate(sizeof(Board));
+    if (memory == nullptr) {
+        return nullptr;
+    }
+    // tree boards never undo, so the history is neither copied nor recorded and the Board owns no heap memory
+    Board *stored = new (memory) Board();
+    stored->copyState(board);
+    stored->recordHistory = false;
+    return stored;
+}
+
+Node* MCTS::createRoot(TreeArena &arena, const Board &board, int player) {
+    Board *stored = storeBoard(arena, board);
+    return stored != nullptr ? arena.create(nullptr, board.hashKey, player, stored) : nullptr;
+}
+
+MCTS::MCTS(Node* root, Board &board, int player, const SearchConfig &config, TreeArena* arena, TranspositionTable* transpositionTable) {
     this->root = root;
-    this->root->board = board;
+    this->config = config;
+    this->arena = arena;
+    this->transpositionTable = transpositionTable;
+    this->root->board->copyState(board);
+    this->root->board->recordHistory = false;
+    this->root->hashKey = board.hashKey;
     this->root->player = player;
+    this->evaluator = Evaluator::get(board.geometry);
+    this->kernel = MoveKernel::get(board.col, board.row);
 }
 
 Node* MCTS::findChildNode(Node* node, const Move &move) {
-    for (Node *child : node->children) {
-        if (child->move.seq == move.seq) {
-            return child;
+    CompactMove target = CompactMove::fromMove(move, node->board->col);
+    int childCount = node->childCount.load();
+    for (int i = 0; i < childCount; i++) {
+        if (node->children.moves()[i] == target) {
+            return node->children.nodes()[i];
         }
     }
     return nullptr;
 }
 
-// reuse the same tree by re-rooting the tree to the new root and delete the old parts of the tree
-Node* MCTS::reRoot(Node *root, const Move &move) {
+// move a subtree into another arena together with its child blocks and boards, what is left behind is released
+// with the old arena. The subtree never needs more than the arena it comes from, so an arena of the same size
+// always has room for it.
+Node* MCTS::moveTree(Node* node, Node* parent, TreeArena &arena) {
+    Node *copy = arena.create(std::move(*node));
+    if (parent == nullptr && copy->parent != nullptr) { // a new root takes over the statistics its old parent held
+        copy->ownWins.store(copy->wins().load());
+        copy->ownVisits.store(copy->visits().load());
+        copy->ownProven.store(copy->proven().load());
+    }
+    if (copy->board != nullptr || parent == nullptr) { // a root always keeps its board
+        copy->board = storeBoard(arena, nodeBoard(node));
+    }
+    if (copy->children.size() > 0) { // no search is running, nothing changes the statistics while they are copied
+        copy->children.moveTo(static_cast<char*>(arena.allocate(ChildBlock::bytes(copy->children.size()))));
+    }
+    copy->parent = parent;
+    Node **children = copy->children.nodes();
+    for (int i = 0; i < copy->childCount.load(); i++) {
+        children[i] = moveTree(children[i], copy, arena);
+    }
+    return copy;
+}
+
+// reuse the same tree by re-rooting the tree to the new root and release the old parts of the tree
+// the kept subtree is moved to spareArena, the arena holding the old tree is released in one go and the two are swapped
+Node* MCTS::reRoot(Node *root, const Move &move, TreeArena &arena, TreeArena &spareArena) {
     Node *newRoot = MCTS::findChildNode(root, move);
-    if (newRoot == nullptr) { // delete the tree if for some reason the new root is not found
-        MCTS::deleteTree(root);
+    if (newRoot == nullptr) { // drop the tree if for some reason the new root is not found
+        arena.release();
         return nullptr;
-    } else {
-        if (newRoot->parent != nullptr && newRoot != root) { // detach the new root from the tree so that deleteTree won't delete newRoot
-            vector<Node*>& childrenVector = newRoot->parent->children;
-            childrenVector.erase(remove(childrenVector.begin(), childrenVector.end(), newRoot), childrenVector.end());
-            newRoot->parent = nullptr;
-            MCTS::deleteTree(root);
-        }
-        return newRoot;
     }
+    spareArena.release();
+    newRoot = MCTS::moveTree(newRoot, nullptr, spareArena);
+    arena.release();
+    arena.swap(spareArena);
+    return newRoot;
 }
 
 // custom win check
 // return 1 if black wins, 2 if white wins, -1 if ties, 0 if still playing
 int MCTS::checkWin(Board &board) {
-    if (board.tieCount >= board.tieMax) {
-        return -1;
-    }
-
-    if (board.blackCount == 0) {
-        return 2;
-    } else if (board.whiteCount == 0) {
-        return 1;
-    }
-
-    vector<vector<Move>> allMoves = board.getAllPossibleMoves(1);
-    if (allMoves.size() == 0) {
-        return 2;
-    }
-
-    allMoves = board.getAllPossibleMoves(2);
-    if (allMoves.size() == 0) {
-        return 1;
-    }
-
-    return 0;
+    return board.gameResult();
 }
 
-bool Node::isFullyExpanded() { // a node is fully expanded if all children have been visited or the node is a leaf node (or is it called terminal node?)
-    return isLeaf || (unvisitedMoves.size() == 0); //  && visits > 0
+bool Node::isFullyExpanded() { // a node is fully expanded if all children have been visited, a terminal node has none
+    return unvisitedCount.load(memory_order_acquire) == 0; //  && visits > 0
 }
 
-double MCTS::getUCT(Node* node) {
-    if (node->visits == 0) {
-        return INFINITY;
-    }
+// UCT = winRate + sqrt(2) * sqrt(log(parentVisits) / visits) for every child of node, with --rave the win rate is
+// blended with the child's AMAF win rate. The statistics are first
+// copied out of node->children a chunk at a time, then the values of the chunk are computed two at a time with
+// SSE2, with the same operations in the same order as the scalar formula.
+int MCTS::bestUCTChild(Node* node, int childCount) {
+    const int CHUNK = 64;
+    double numerator[CHUNK], denominator[CHUNK], visitCount[CHUNK], value[CHUNK];
+    const atomic<double> *wins = node->children.wins();
+    const atomic<int> *visitsOf = node->children.visits(), *virtualLoss = node->children.virtualLoss();
+    const atomic<double> *ttWins = node->children.ttWins();
+    const atomic<int> *ttVisits = node->children.ttVisits();
+    const atomic<signed char> *proven = node->children.proven();
+    const atomic<double> *raveWins = node->children.raveWins();
+    const atomic<int> *raveVisits = node->children.raveVisits();
+    const double k = config.raveEquivalence;
+    int parentVisits = max(1, node->visits().load(memory_order_relaxed) + node->virtualLoss().load(memory_order_relaxed));
+    double logParentVisits = log(parentVisits); // the same for every child
     // TODO: fine tune the c constant value
-    return (double)node->wins / node->visits + sqrt(2) * sqrt(log(node->parent->visits) / (node->visits + 1e-6));
+    const double c = sqrt(2);
+    double bestUCTValue = -INFINITY;
+    int best = 0;
+    for (int begin = 0; begin < childCount; begin += CHUNK) {
+        int count = min(CHUNK, childCount - begin);
+        for (int i = 0; i < count; i++) {
+            // simulations still running below a node count as visits without wins (virtual loss), so other threads spread out
+            int pending = virtualLoss[begin + i].load(memory_order_relaxed);
+            int visits = visitsOf[begin + i].load(memory_order_relaxed) + pending;
+            visitCount[i] = visits;
+            numerator[i] = wins[begin + i].load(memory_order_relaxed);
+            denominator[i] = visits;
+            // the position may have been reached on other paths as well, use the shared statistics; they are the
+            // table's entry as of the child's last backpropagation, 0 without a table
+            int sharedVisits = ttVisits[begin + i].load(memory_order_relaxed);
+            if (visits > 0 && sharedVisits > visits) {
+                numerator[i] = ttWins[begin + i].load(memory_order_relaxed);
+                denominator[i] = sharedVisits + pending;
+            }
+            int amafVisits = k > 0 && visits > 0 ? raveVisits[begin + i].load(memory_order_relaxed) : 0;
+            if (amafVisits > 0) { // RAVE: the AMAF win rate weighs beta = sqrt(k / (3 visits + k)), fading as the child is visited
+                double beta = sqrt(k / (3.0 * visits + k));
+                double amafRate = raveWins[begin + i].load(memory_order_relaxed) / amafVisits;
+                numerator[i] = (1.0 - beta) * numerator[i] / denominator[i] + beta * amafRate;
+                denominator[i] = 1.0;
+            }
+        }
+        int i = 0;
+#ifdef __SSE2__
+        const __m128d cs = _mm_set1_pd(c), logs = _mm_set1_pd(logParentVisits), epsilon = _mm_set1_pd(1e-6);
+        for (; i + 2 <= count; i += 2) {
+            __m128d winRate = _mm_div_pd(_mm_loadu_pd(numerator + i), _mm_loadu_pd(denominator + i));
+            __m128d exploration = _mm_sqrt_pd(_mm_div_pd(logs, _mm_add_pd(_mm_loadu_pd(visitCount + i), epsilon)));
+            _mm_storeu_pd(value + i, _mm_add_pd(winRate, _mm_mul_pd(cs, exploration)));
+        }
+#endif
+        for (; i < count; i++) {
+            value[i] = numerator[i] / denominator[i] + c * sqrt(logParentVisits / (visitCount[i] + 1e-6));
+        }
+        for (i = 0; i < count; i++) {
+            double uctValue = visitCount[i] == 0 ? INFINITY : value[i];
+            signed char solved = proven[begin + i].load(memory_order_relaxed);
+            if (solved == Node::PROVEN_LOSS) { // never walk into a proven loss, a proven win is taken at once
+                uctValue = -INFINITY;
+            } else if (solved == Node::PROVEN_WIN) {
+                uctValue = INFINITY;
+            }
+            if (uctValue > bestUCTValue) {
+                bestUCTValue = uctValue;
+                best = begin + i;
+            }
+        }
+    }
+    return best;
 }
 
 // force capture that can capture multiple pieces
@@ -173,38 +400,36 @@ double MCTS::isVulnerableMove(Board &board, const Move &move, int player) {
 
     //--------------------------------------------------------------------------------------------------------------
 
-    int current_player = player;
+    return isVulnerableMove(board, CompactMove::fromMove(move, board.col), player);
+}
+
+// number of pieces the opponent can capture before the move minus after it
+double MCTS::isVulnerableMove(Board &board, const CompactMove &move, int player) {
     int opponent = player == 1 ? 2 : 1;
+    static thread_local MoveList captures;
 
     int numCapturesBefore = 0;
-    vector<vector<Move>> allMoves = board.getAllPossibleMoves(opponent);
-    for (vector<Move> moves : allMoves) {
-        for (Move move : moves) {
-            if (move.isCapture()) {
-                numCapturesBefore += move.seq.size() - 1;
-            }
-        }
+    kernel->generate(board, opponent, captures, true);
+    for (int i = 0; i < captures.size(); i++) {
+        numCapturesBefore += captures[i].steps;
     }
 
-    board.makeMove(move, current_player);
+    Board after; // a history free copy, so the move does not have to be undone
+    after.copyState(board);
+    after.recordHistory = false;
+    after.makeMove(move, player);
     int numCapturesAfter = 0;
-    allMoves = board.getAllPossibleMoves(opponent);
-    for (vector<Move> moves : allMoves) {
-        for (Move move : moves) {
-            if (move.isCapture()) {
-                numCapturesAfter += move.seq.size() - 1;
-            }
-        }
+    kernel->generate(after, opponent, captures, true);
+    for (int i = 0; i < captures.size(); i++) {
+        numCapturesAfter += captures[i].steps;
     }
 
-    board.Undo();
     return numCapturesBefore - numCapturesAfter;
 }
 
 // check if a move will cause promote
 bool MCTS::isPromoting(const Board &board, const Move &move, int player) {
-    Checker checker = board.board[move.seq[0].x][move.seq[0].y];
-    if (checker.isKing) { // skip if it's already king
+    if (board.isKingAt(move.seq[0].x, move.seq[0].y)) { // skip if it's already king
         return false;
     }
     Position next_pos = move.seq[move.seq.size() - 1];
@@ -216,165 +441,193 @@ bool MCTS::isPromoting(const Board &board, const Move &move, int player) {
     return false;
 }
 
+bool MCTS::isPromoting(const Board &board, const CompactMove &move, int player) {
+    // the last square of the path decides, like the Move version
+    return !board.kings.test(move.from) && board.geometry->promotionRow[player].test(move.to);
+}
+
 // evaluate the board position after the momve and returns the score
+// the piece-square tables give the score before the move, the move only changes the squares it touches
 double MCTS::generalBoardPositionEvaluation(Board &board, const Move &move, int player) {
-    double score = 0.0;
-    board.makeMove(move, player);
-
-    // TODO: fine tune the scores
-    string playerColor = player == 1 ? "B" : "W";
-    double kingScore = 0.7;
-    double centerScore = 0.5;
-    double edgeScore = 0.3;
-    double defensiveScore = 0.2;
-    double scoreMultiplier = 1.0 * (board.col / 7.0);
-
-    for (int i = 0; i < board.row; i++) { // iterating the board and give points based on player and opponents position
-        for (int j = 0; j < board.col; j++) {
-            Checker checker = board.board[i][j];
-            if (checker.color != "B" && checker.color != "W") { // skip empty positions
-                continue;
-            }
-
-            double currentCheckerScore = 0.0;
-            
-            if (checker.isKing) { // give extra score for king
-                currentCheckerScore += kingScore;
-            }
-
-            double distanceToCenter = sqrt(pow(i - board.row / 2.0, 2) + pow(j - board.col / 2.0, 2));
-            currentCheckerScore += centerScore / (distanceToCenter + 1.0); // give score for being closer to center
-
-            if (j == 0 || j == board.col - 1) { // give score for being on the edge
-                currentCheckerScore += edgeScore;
-            }
-            
-            if (checker.color == "B" && i == 0) { // give score for being in denfensive position
-                currentCheckerScore += defensiveScore;
-            } else if (checker.color == "W" && i == board.row - 1) {
-                currentCheckerScore += defensiveScore;
-            }
-
-            if (checker.color == playerColor) { // add/subtract score based on player/opponent
-                score += currentCheckerScore;
-            } else {
-                score -= currentCheckerScore;
-            }
-        }
-    }
-
-    board.Undo();
-    return scoreMultiplier * score;
+    return evaluator->evaluate(board, player) + evaluator->moveDelta(board, move, player);
 }
 
 Node* MCTS::selectNode(Node* node) {
     Node *current = node;
-    // repeatedly going down the tree until the current node has no children or is not fully expanded
-    while (current->children.size() > 0 && current->isFullyExpanded()) {
-        double bestUCTValue = -INFINITY;
-        Node *bestChild = nullptr;
-        // iterate all the children and find the one with the best UCT value
-        for (Node *child : current->children) {
-            double uctValue = getUCT(child);
-            if (uctValue > bestUCTValue) { // && !child->isLeaf
-                bestUCTValue = uctValue;
-                bestChild = child;
-            }
-        }
-        current = bestChild;
+    // repeatedly going down the tree until the current node has no children, is not fully expanded or is proven
+    int childCount;
+    while ((childCount = current->childCount.load(memory_order_acquire)) > 0 && current->isFullyExpanded()
+           && current->proven().load(memory_order_relaxed) == Node::UNPROVEN) {
+        int best = bestUCTChild(current, childCount);
+        current->children.virtualLoss()[best].fetch_add(config.virtualLoss, memory_order_relaxed);
+        current = current->children.nodes()[best];
     }
     return current;
 }
 
 Node* MCTS::expandNode(Node* node) {
-    vector<vector<Move>> allMoves = node->board.getAllPossibleMoves(node->player);
-    if (allMoves.size() == 0) { // return nullptr if the node has no possible moves
-        return nullptr;
-    }
-
-    // if the node has not been initialized, then save all possible moves
-    if (!node->initialized) { 
-        for (vector<Move> moves : allMoves) {
-            for (Move move : moves) {
-                node->unvisitedMoves.push_back(move);
-            }
+    ExpansionGuard guard(node); // one thread at a time initializes the node or adds a child to it
+
+    // the first visit generates the moves and shuffles them, every expansion then takes the next one in that order
+    if (!node->initialized) {
+        static thread_local MoveList allMoves; // reused, so generating the moves does not allocate
+        static thread_local vector<CompactMove> wideMoves; // the rare position with more than MoveList::CAPACITY
+        const Board &board = nodeBoard(node);
+        kernel->generate(board, node->player, allMoves, false);
+        CompactMove *moves = allMoves.moves;
+        int moveCount = allMoves.size();
+        if (allMoves.overflow) { // a partial move list would let the solver prove a wrong result
+            board.getAllPossibleMoves(node->player, wideMoves);
+            moves = wideMoves.data();
+            moveCount = wideMoves.size();
+        }
+        for (int i = moveCount - 1; i > 0; i--) {
+            swap(moves[i], moves[randomIndex(i + 1)]);
         }
+        // the game is over when the player to move has no moves or the tie count has run out, the node then
+        // gets no children and its result is known
+        int winner = board.tieCount >= board.tieMax ? -1 : moveCount == 0 ? board.gameResult() : 0;
+        int count = winner == 0 ? moveCount : 0;
+        char *storage = nullptr;
+        if (count > 0 && (storage = static_cast<char*>(arena->allocate(ChildBlock::bytes(count)))) == nullptr) {
+            return nullptr; // the tree budget is used up
+        }
+        node->children.assign(storage, moves, count);
+        node->unvisitedCount.store(count, memory_order_release);
         node->initialized = true;
+        if (winner != 0) {
+            node->proven().store(winner == -1 ? Node::PROVEN_DRAW : winner == node->player ? Node::PROVEN_LOSS : Node::PROVEN_WIN,
+                                 memory_order_relaxed);
+        }
     }
 
-    if (node->unvisitedMoves.size() == 0) { // if still has no unvisited moves, then it's fully expanded
+    int next = node->childCount.load(memory_order_relaxed);
+    if (next == node->children.size()) { // fully expanded, or the node has no possible moves
         return nullptr;
     }
-
-    // randomly select an unvisited move
-    int i = rand() % (node->unvisitedMoves.size());
-    Move randomMove = node->unvisitedMoves[i];
-
-    // create a new node for the selected move
-    Board newBoard = node->board;
-    newBoard.makeMove(randomMove, node->player);
-    Node *newNode = new Node(node, randomMove, newBoard, node->player == 1 ? 2 : 1);
-    node->children.push_back(newNode);
-
-    // remove the selected move from the unvisitedMoves
-    node->unvisitedMoves.erase(node->unvisitedMoves.begin() + i);
+    const CompactMove &move = node->children.moves()[next];
+
+    // create a new node for the move, or stop expanding when the tree budget is used up
+    static thread_local Board newBoard;
+    newBoard.copyState(nodeBoard(node));
+    newBoard.recordHistory = false;
+    newBoard.makeMove(move, node->player);
+    Board *kept = nullptr;
+    if ((node->ply + 1) % config.boardInterval == 0 && (kept = storeBoard(*arena, newBoard)) == nullptr) {
+        return nullptr;
+    }
+    Node *newNode = arena->create(node, newBoard.hashKey, node->player == 1 ? 2 : 1, kept);
+    if (newNode == nullptr) {
+        return nullptr;
+    }
+    newNode->slot = next;
+    node->children.virtualLoss()[next].store(config.virtualLoss, memory_order_relaxed);
+    node->children.nodes()[next] = newNode;
+    node->childCount.store(next + 1, memory_order_release);
+    node->unvisitedCount.store(node->children.size() - next - 1, memory_order_release);
 
     return newNode; // returns the expanded node
 }
 
-int MCTS::simulation(Node* node) {
-    Board board = node->board;
+// with --board-interval K only every K-th ply keeps its Board (the root always does), a node without one is
+// rebuilt by replaying the moves below its nearest ancestor with a board, at most K - 1 of them
+// the reference stays valid until the next call on the same thread
+const Board& MCTS::nodeBoard(Node* node) {
+    if (node->board) {
+        return *node->board;
+    }
+    static thread_local Board replayBoard;
+    static thread_local vector<Node*> path;
+    path.clear();
+    Node *checkpoint = node;
+    while (!checkpoint->board) {
+        path.push_back(checkpoint);
+        checkpoint = checkpoint->parent;
+    }
+    replayBoard.copyState(*checkpoint->board);
+    replayBoard.recordHistory = false;
+    for (size_t i = path.size(); i-- > 0;) {
+        replayBoard.makeMove(path[i]->move(), path[i]->parent->player);
+    }
+    return replayBoard;
+}
+
+// playouts run on a per-thread scratch board that takes over the node's position, never a copy of the node's Board
+static thread_local Board scratchBoard;
+
+// returns the root player's score: 1 for a win, 0 for a loss, 0.5 for a tie, or the evaluation's win probability
+// when the playout is cut off after config.playoutDepth plies
+double MCTS::simulation(Node* node) {
+    Board &board = scratchBoard;
+    board.copyState(nodeBoard(node));
+    board.recordHistory = false; // the playout is thrown away, not undone
     int player = node->player;
     int lastMovedPlayer = player;
     int noCaptureCount = 0;
-    while (true) {
-        vector<vector<Move>> allMoves = board.getAllPossibleMoves(player);
+    static thread_local MoveList allMoves;
+    bool rave = config.raveEquivalence > 0;
+    if (rave) {
+        amafMoves.begin(board.col * board.row);
+    }
+    for (int ply = 0; ; ply++) {
+        // a finished game is still scored by its result, only a position that goes on is left to the evaluation
+        if (ply == config.playoutDepth && kernel->hasAnyLegalMove(board, player)) {
+            return evaluator->winProbability(board, root->player);
+        }
+        kernel->generate(board, player, allMoves, false);
         if (noCaptureCount >= 40) { // stops simulation if no capture moves have been made for 40 turns (prevent infinite loop, also 40 is the tie count)
-            return -1;
+            return 0.5;
         }
         if (allMoves.size() == 0) { // stops simulation if a player has no possible moves
             break;
         }
         
-        Move bestMove;
-        int randomNumber = std::rand() % 100;
+        const CompactMove *bestMove = nullptr; // points into allMoves, no copy per ply
+        int randomNumber = randomIndex(100);
         // control the percentage of using random vs heuristic moves
-        if (randomNumber < 70) {
+        if (randomNumber >= config.heuristicPercent) {
              // pure random moves
-            int i = rand() % (allMoves.size());
-            vector<Move> checker_moves = allMoves[i];
-            int j = rand() % (checker_moves.size());
-            bestMove = checker_moves[j];
+            if (allMoves.overflow) {
+                // the groups past CAPACITY are empty, any of the kept moves is still a legal playout move
+                bestMove = &allMoves[randomIndex(allMoves.size())];
+            } else {
+                int i = randomIndex(allMoves.groups); // a random piece, then one of its moves
+                int j = randomIndex(allMoves.groupSize(i));
+                bestMove = &allMoves.inGroup(i, j);
+            }
         } else {
             double bestScore = -INFINITY;
-            for (vector<Move> moves : allMoves) {
-                for (Move move : moves) {
-                    double score = 0.0;
-                    if (move.isCapture()) { // direct capture
-                        score += 4.0;
-                        score += move.seq.size() - 1; // give extra score for multiple captures
-                    }
-                    
-                    // score += isVulnerableMove(board, move, player); // check if move leads to direct captures by opponent
-    
-                    if (isPromoting(board, move, player)) { // check if next move will promote
-                        score += 1.0;
-                    }
-    
-                    score += generalBoardPositionEvaluation(board, move, player); // evaluate the board position after the move
-    
-                    if (score > bestScore) {
-                        bestScore = score;
-                        bestMove = move;
-                    }   
+            double positionScore = evaluator->evaluate(board, player); // shared by every candidate move
+            for (int k = 0; k < allMoves.size(); k++) {
+                const CompactMove &move = allMoves[k];
+                double score = 0.0;
+                if (move.isCapture()) { // direct capture
+                    score += 4.0;
+                    score += move.steps; // give extra score for multiple captures
+                }
+                
+                // score += isVulnerableMove(board, move, player); // check if move leads to direct captures by opponent
+
+                if (isPromoting(board, move, player)) { // check if next move will promote
+                    score += 1.0;
                 }
+
+                score += positionScore + evaluator->moveDelta(board, move, player); // evaluate the board position after the move
+
+                if (score > bestScore) {
+                    bestScore = score;
+                    bestMove = &move;
+                }   
             }
         }
 
-        board.makeMove(bestMove, player);
+        if (rave) {
+            amafMoves.add(player, *bestMove);
+        }
+        board.makeMove(*bestMove, player);
         lastMovedPlayer = player;
 
-        if (bestMove.isCapture()) { // count the number of non capture moves
+        if (bestMove->isCapture()) { // count the number of non capture moves
             noCaptureCount = 0;
         } else {
             noCaptureCount++;
@@ -387,81 +640,301 @@ int MCTS::simulation(Node* node) {
     int winning_player = checkWin(board); // custom win check, return 1 if black wins, 2 if white wins
     int opponent = root->player == 1 ? 2 : 1;
     if (winning_player == root->player) { // return 1 if the root player wins
-        return 1;
+        return 1.0;
     } else if (winning_player == opponent) { // return 0 if the root player loses
-        return 0;
-    } else { // else return -1 if it's a tie
-        return -1;
+        return 0.0;
+    } else { // else return 0.5 if it's a tie
+        return 0.5;
     }
 }
 
-void MCTS::backPropagation(Node* node, int result) {
+// MCTS-Solver: the player to move at a node picks a child that is a proven win for them, so the node is lost for
+// the player who moved into it; it is won once every move has a child and all of them are proven losses
+signed char MCTS::solve(Node* node) {
+    int childCount = node->childCount.load(memory_order_acquire);
+    const atomic<signed char> *proven = node->children.proven();
+    bool allLost = childCount > 0 && childCount == node->children.size();
+    for (int i = 0; i < childCount; i++) {
+        signed char value = proven[i].load(memory_order_relaxed);
+        if (value == Node::PROVEN_WIN) {
+            return Node::PROVEN_LOSS;
+        }
+        if (value != Node::PROVEN_LOSS) {
+            allLost = false;
+        }
+    }
+    return allLost ? Node::PROVEN_WIN : Node::UNPROVEN;
+}
+
+// 1 if the root player wins, 0 if it loses, 0.5 for a tie, like simulation
+double MCTS::provenResult(Node* node) {
+    signed char value = node->proven().load(memory_order_relaxed);
+    if (value == Node::PROVEN_DRAW) {
+        return 0.5;
+    }
+    int mover = node->player == 1 ? 2 : 1;
+    int winner = value == Node::PROVEN_WIN ? mover : node->player;
+    return winner == root->player ? 1.0 : 0.0;
+}
+
+// every move of node that its player made at some point below it in this iteration, in the tree or in the playout,
+// counts as if it had been played first: all moves as first. Moves not expanded yet keep their statistics too.
+void MCTS::updateAmaf(Node* node, double score) {
+    if (node->childCount.load(memory_order_acquire) == 0) { // not initialized by another thread yet, or terminal
+        return;
+    }
+    double winScore = node->player == root->player ? score : 1.0 - score; // for the player who moves at node
+    const CompactMove *moves = node->children.moves();
+    atomic<double> *raveWins = node->children.raveWins();
+    atomic<int> *raveVisits = node->children.raveVisits();
+    for (int i = 0; i < node->children.size(); i++) {
+        if (amafMoves.contains(node->player, moves[i])) {
+            raveVisits[i].fetch_add(1, memory_order_relaxed);
+            atomicAdd(raveWins[i], winScore);
+        }
+    }
+}
+
+void MCTS::backPropagation(Node* node, double score) {
+    // a proven node may decide its parent, and that one its own parent, as far up as the values are decided
+    for (Node *child = node; child != root && child->proven().load(memory_order_relaxed) != Node::UNPROVEN;) {
+        Node *parent = child->parent;
+        signed char value = solve(parent);
+        if (value == Node::UNPROVEN || parent->proven().exchange(value, memory_order_relaxed) == value) {
+            break; // undecided, or another thread got there first
+        }
+        child = parent;
+    }
+
     Node *current = node;
     double winScore = 0.0;
 
     while (current != nullptr) { // repeatedly going up the tree and update wins and visits
-        current->visits++;
-
-        // increasing number of wins for each node based on root player's perspective (but flipped)
-        // not sure why but it just works
-        if (result == -1) { // Tie
-            winScore = 0.5;
-        } else if (current->player == root->player) { // +0 if root player wins, +1 if loses
-            winScore = (result == 0) ? 1.0 : 0.0;
+        current->visits().fetch_add(1, memory_order_relaxed);
+        if (current != root) { // every node below the root on the path carries this iteration's virtual loss
+            current->virtualLoss().fetch_sub(config.virtualLoss, memory_order_relaxed);
+        }
+
+        // the wins of a node count for the player who moved into it, the opponent of its player to move
+        if (current->player == root->player) { // +0 if root player wins, +1 if loses
+            winScore = 1.0 - score;
         } else { // vice versa
-            winScore = (result == 1) ? 1.0 : 0.0;
+            winScore = score;
         }
 
-        current->wins += winScore;
+        current->addWins(winScore);
+        if (transpositionTable != nullptr) {
+            TTEntry entry;
+            transpositionTable->update(current->hashKey, winScore, &entry);
+            if (current->parent != nullptr) { // what selection at the parent uses instead of probing
+                current->parent->children.ttWins()[current->slot].store(entry.wins, memory_order_relaxed);
+                current->parent->children.ttVisits()[current->slot].store(entry.visits, memory_order_relaxed);
+            }
+        }
+        if (config.raveEquivalence > 0) { // the root too, its choice of child is the one that matters most
+            updateAmaf(current, score);
+            if (current->parent != nullptr) {
+                amafMoves.add(current->parent->player, current->move()); // played after the parent, like the moves below
+            }
+        }
         current = current->parent;
     }
 }
 
 
-void MCTS::runMCTS(int time) {
+int MCTS::runMCTS(int time) {
     auto start = high_resolution_clock::now();
-    for (int i = 0; i < time; i++) {
-        // time limit for each move
-        if (duration_cast<milliseconds>(high_resolution_clock::now() - start) > seconds(20)) {
-            break;
+    // without a time manager config.moveSeconds is a fixed time limit, 0 searches until the iteration budget is used
+    auto moveLimit = duration<double>(config.moveSeconds > 0 || timeManager != nullptr ? config.moveSeconds : INFINITY);
+    if (transpositionTable != nullptr) {
+        transpositionTable->newSearch();
+    }
+    // every thread runs iterations on the shared tree until the iteration budget or the time limit is used up
+    atomic<int> iterations(0);
+    atomic<int> completed(0);
+    atomic<bool> timeUp(false);
+    auto worker = [&](int index) {
+        // the stream depends only on the seed, the position and the thread, so a single threaded search with a
+        // fixed iteration budget is reproducible
+        uint64_t stream = config.seed ^ root->hashKey;
+        stream += 0x632BE59BD9B4E019ULL * (index + 1);
+        threadRandom.reseed(splitMix64(stream));
+        bool checksClock = index == 0;
+        int sinceCheck = 0;
+        while (iterations.fetch_add(1, memory_order_relaxed) < time) {
+            if (timeUp.load(memory_order_relaxed)) {
+                break;
+            }
+            if (stop != nullptr && stop->load(memory_order_relaxed)) {
+                break;
+            }
+            // the calling thread keeps the clock, helpers only watch timeUp
+            if (checksClock && ++sinceCheck >= CLOCK_CHECK_INTERVAL) {
+                sinceCheck = 0;
+                duration<double> elapsed = high_resolution_clock::now() - start;
+                if (timeManager != nullptr ? timeManagerSaysStop(elapsed.count(), completed.load()) : elapsed > moveLimit) {
+                    timeUp.store(true);
+                    break;
+                }
+            }
+            if (root->proven().load(memory_order_relaxed) != Node::UNPROVEN) { // the solver has decided the game
+                break;
+            }
+            Node* selectedNode = selectNode(root); 
+            Node* expandedNode = selectedNode->proven().load(memory_order_relaxed) != Node::UNPROVEN ? nullptr : expandNode(selectedNode);
+            if (expandedNode == nullptr) { // if can't expand, the run simulation on the selected node
+                expandedNode = selectedNode;
+            }
+            // a proven node needs no playout, its moves for the AMAF statistics are the ones in the tree
+            if (config.raveEquivalence > 0 && expandedNode->proven().load(memory_order_relaxed) != Node::UNPROVEN) {
+                amafMoves.begin(root->board->col * root->board->row);
+            }
+            double score = expandedNode->proven().load(memory_order_relaxed) != Node::UNPROVEN ? provenResult(expandedNode) : simulation(expandedNode);
+            backPropagation(expandedNode, score);
+            completed.fetch_add(1, memory_order_relaxed);
         }
-        Node* selectedNode = selectNode(root); 
-        Node* expandedNode = expandNode(selectedNode);
-        if (expandedNode == nullptr) { // if can't expand, the run simulation on the selected node
-            expandedNode = selectedNode;
+    };
+    vector<thread> helpers;
+    for (int t = 1; t < config.threads; t++) {
+        helpers.push_back(thread(worker, t));
+    }
+    worker(0);
+    for (thread &helper : helpers) {
+        helper.join();
+    }
+    return completed.load();
+}
+
+// hands the two most visited root children to the time manager
+bool MCTS::timeManagerSaysStop(double elapsed, int iterations) {
+    int childCount = root->childCount.load(memory_order_acquire);
+    int best = -1, bestVisits = 0, secondVisits = 0;
+    for (int i = 0; i < childCount; i++) {
+        int visits = root->children.visits()[i].load(memory_order_relaxed);
+        if (best == -1 || visits > bestVisits) {
+            secondVisits = bestVisits;
+            bestVisits = visits;
+            best = i;
+        } else if (visits > secondVisits) {
+            secondVisits = visits;
         }
-        int result = simulation(expandedNode);
-        backPropagation(expandedNode, result);
     }
+    if (childCount == 1 && root->isFullyExpanded()) { // a forced move needs no thought
+        return true;
+    }
+    return timeManager->shouldStop(elapsed, iterations, best, bestVisits, secondVisits);
 }
 
-// picking the best move based the the most visits
+// picking the best move based the the most visits, a proven win is played at once and a proven loss only when
+// every move loses
 Move MCTS::getBestMove() { 
     double mostVisit = -INFINITY;
-    Move bestMove;
-    for (Node *child : root->children) { // find the child with the most visits
-        // cout << "Child move: " << child->move.toString() << ", visits: " << child->visits << ", wins: " << child->wins << endl;
-        if (child->visits > mostVisit) {
-            mostVisit = child->visits;
-            bestMove = child->move;
+    bool bestLost = true;
+    CompactMove bestMove;
+    int childCount = root->childCount.load();
+    for (int i = 0; i < childCount; i++) { // find the child with the most visits
+        signed char proven = root->children.proven()[i].load();
+        if (proven == Node::PROVEN_WIN) {
+            return root->children.moves()[i].toMove(root->board->col);
+        }
+        bool lost = proven == Node::PROVEN_LOSS;
+        int visits = root->children.visits()[i].load();
+        if ((bestLost && !lost) || (bestLost == lost && visits > mostVisit)) {
+            mostVisit = visits;
+            bestLost = lost;
+            bestMove = root->children.moves()[i];
         }
     }
 
-    return bestMove;
+    return bestMove.toMove(root->board->col);
 }
 
-void MCTS::deleteTree(Node* node) { // TODO: check memory leak?
-    if (node == nullptr) {
-        return;
+// picking the move with the most visits summed over the root children of every tree
+Move MCTS::getBestMove(const vector<Node*> &roots) {
+    // a root has a few dozen moves at most, a linear lookup is enough; -1 once one of the trees proved the move lost
+    vector<pair<CompactMove, int> > totalVisits;
+    for (Node *root : roots) {
+        int childCount = root->childCount.load();
+        for (int i = 0; i < childCount; i++) {
+            const CompactMove &move = root->children.moves()[i];
+            signed char proven = root->children.proven()[i].load();
+            if (proven == Node::PROVEN_WIN) {
+                return move.toMove(root->board->col);
+            }
+            size_t k = 0;
+            while (k < totalVisits.size() && totalVisits[k].first != move) {
+                k++;
+            }
+            if (k == totalVisits.size()) {
+                totalVisits.push_back(make_pair(move, 0));
+            }
+            int &visits = totalVisits[k].second;
+            if (proven == Node::PROVEN_LOSS) {
+                visits = -1;
+            } else if (visits >= 0) {
+                visits += root->children.visits()[i].load();
+            }
+        }
+    }
+    int mostVisit = -2;
+    CompactMove bestMove;
+    for (const pair<CompactMove, int> &total : totalVisits) {
+        if (total.second > mostVisit) {
+            mostVisit = total.second;
+            bestMove = total.first;
+        }
+    }
+    return roots.empty() ? Move() : bestMove.toMove(roots[0]->board->col);
+}
+
+// root parallel search: every thread builds its own tree from the same position with its own arena and no
+// shared state, the trees only meet when their root visits are merged
+Move MCTS::runRootParallel(Board &board, int player, int time, const SearchConfig &config, int *iterations) {
+    int threads = config.threads;
+    SearchConfig single = config;
+    single.threads = 1;
+    int share = time / threads + (time % threads != 0 ? 1 : 0);
+    vector<unique_ptr<TreeArena> > arenas;
+    for (int t = 0; t < threads; t++) {
+        arenas.push_back(unique_ptr<TreeArena>(new TreeArena(max(1, config.treeMegabytes / threads))));
+    }
+    vector<Node*> roots(threads, nullptr);
+    vector<int> done(threads, 0);
+    vector<thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.push_back(thread([&, t]() {
+            SearchConfig treeConfig = single; // every tree needs its own random stream
+            uint64_t state = config.seed + t;
+            treeConfig.seed = splitMix64(state);
+            roots[t] = MCTS::createRoot(*arenas[t], board, player);
+            MCTS mcts(roots[t], board, player, treeConfig, arenas[t].get());
+            done[t] = mcts.runMCTS(share);
+        }));
     }
-    for (Node *child : node->children) {
-        deleteTree(child);
+    for (thread &worker : workers) {
+        worker.join();
     }
-    delete node;
+    if (iterations != nullptr) {
+        *iterations = 0;
+        for (int count : done) {
+            *iterations += count;
+        }
+    }
+    return getBestMove(roots);
 }
 
 
-StudentAI::StudentAI(int col,int row,int p) : AI(col, row, p) {
+StudentAI::StudentAI(int col,int row,int p) : StudentAI(col, row, p, SearchConfig()) {
+}
+
+StudentAI::StudentAI(int col,int row,int p,const SearchConfig &config)
+    : AI(col, row, p), config(config), transpositionTable(config.tableMegabytes),
+      nodeArena(config.treeMegabytes), spareArena(config.treeMegabytes),
+      timeLimit(duration<double>(config.totalSeconds)), timeManager(config.moveSeconds) {
+    if (this->config.seed == 0) {
+        this->config.seed = ((uint64_t)random_device()() << 32) | random_device()();
+    }
+    random.reseed(this->config.seed);
     board = Board(col,row,p);
     board.initializeGame();
     player = 2;
@@ -477,9 +950,9 @@ Move StudentAI::GetRandomMove(Move move) {
     }
 
     vector<vector<Move>> allMoves = board.getAllPossibleMoves(player);
-    int i = rand() % (allMoves.size());
+    int i = random.below(allMoves.size());
     vector<Move> checker_moves = allMoves[i];
-    int j = rand() % (checker_moves.size());
+    int j = random.below(checker_moves.size());
 
     board.makeMove(checker_moves[j], player);
 
@@ -489,15 +962,10 @@ Move StudentAI::GetRandomMove(Move move) {
 
 Move StudentAI::GetMove(Move move) {
     auto start = high_resolution_clock::now();
+    finishPondering(); // the opponent has moved, the tree is ours again
     auto remainingTime = timeLimit - timeElapsed;
     if (remainingTime < seconds(2)) { // return random move if only has 2 seconds left
         return GetRandomMove(move); // no need to keep track of the remaining time if started using random moves
-    } else if (remainingTime < seconds(10)) { 
-        MCTS_ITERATIONS = 500;
-    } else if (remainingTime < seconds(30)) { // adjust the number of MCTS iterations based on the remaining time
-        MCTS_ITERATIONS = 1000;
-    } else if (remainingTime < seconds(60)) {
-        MCTS_ITERATIONS = 3000;
     }
 
     if (move.seq.empty())
@@ -507,32 +975,78 @@ Move StudentAI::GetMove(Move move) {
         // re-root to the opponent's move if it's in the tree, otherwise start a new tree
         board.makeMove(move,player == 1?2:1);
         if (MCTSRoot) { // re root if MCTSRoot is not nullptr
-            MCTSRoot = MCTS::reRoot(MCTSRoot, move);
+            MCTSRoot = MCTS::reRoot(MCTSRoot, move, nodeArena, spareArena);
         }
     }
+    timeManager.startMove(board, duration_cast<duration<double> >(remainingTime).count());
+    bool fixedIterations = config.iterations > 0;
+    // only --iterations caps a search, otherwise the time manager alone decides when it stops
+    MCTS_ITERATIONS = fixedIterations ? config.iterations : INT_MAX;
+
+    Move res;
+    if (config.rootParallel) { // independent trees per thread, nothing is kept between moves
+        SearchConfig rootConfig = config; // no shared root to watch, so each tree gets the soft limit
+        if (!fixedIterations) {
+            rootConfig.moveSeconds = max(timeManager.softLimit, 0.001);
+        }
+        res = MCTS::runRootParallel(board, player, MCTS_ITERATIONS, rootConfig);
+        board.makeMove(res, player);
+    } else {
+        if (MCTSRoot == nullptr) { // start a new tree if root is nullptr
+            nodeArena.release();
+            MCTSRoot = MCTS::createRoot(nodeArena, board, player);
+        }
+        MCTS mcts(MCTSRoot, board, player, config, &nodeArena, &transpositionTable);
+        if (!fixedIterations) {
+            mcts.timeManager = &timeManager;
+        }
+        mcts.runMCTS(MCTS_ITERATIONS);
+        res = mcts.getBestMove();
 
-    if (MCTSRoot == nullptr) { // start a new tree if root is nullptr
-        MCTSRoot = new Node(nullptr, Move(), board, player);
-    }
-    MCTS mcts = MCTS(MCTSRoot, board, player);
-    mcts.runMCTS(MCTS_ITERATIONS); // TODO: adjust the number of MCTS iterations
-    Move res = mcts.getBestMove();
-
-    board.makeMove(res, player);
+        board.makeMove(res, player);
 
-    // re-root to the player's next move
-    MCTSRoot = MCTS::reRoot(MCTSRoot, res);
+        // re-root to the player's next move
+        MCTSRoot = MCTS::reRoot(MCTSRoot, res, nodeArena, spareArena);
+    }
 
     auto stop = high_resolution_clock::now();
     timeElapsed += duration_cast<milliseconds>(stop - start);
     // cout << "Move took: " << duration_cast<seconds>(stop - start).count() << " seconds" << endl;
     // cout << "Time elapsed: " << duration_cast<seconds>(timeElapsed).count() << " seconds" << endl;
+    if (config.ponder) {
+        startPondering();
+    }
     return res;
 }
 
+// search the position after our reply from the opponent's side, the time is not counted in timeElapsed
+void StudentAI::startPondering() {
+    if (MCTSRoot == nullptr || MCTS::checkWin(board) != 0) {
+        return;
+    }
+    SearchConfig ponderConfig = config;
+    ponderConfig.moveSeconds = 1e9; // runs until finishPondering
+    ponderSearch.reset(new MCTS(MCTSRoot, board, player == 1 ? 2 : 1, ponderConfig, &nodeArena, &transpositionTable));
+    ponderSearch->stop = &stopPondering;
+    stopPondering.store(false);
+    ponderThread = thread([this]() {
+        ponderSearch->runMCTS(INT_MAX);
+    });
+}
+
+// stop the ponder search and wait for its threads, so GetMove can reRoot and release arenas safely
+// the wait is at most one iteration per search thread
+void StudentAI::finishPondering() {
+    if (!ponderThread.joinable()) {
+        return;
+    }
+    stopPondering.store(true);
+    ponderThread.join();
+    ponderSearch.reset();
+}
 
 StudentAI::~StudentAI() {
-    if (MCTSRoot != nullptr) {
-        MCTS::deleteTree(MCTSRoot);
-    }
+    finishPondering();
+    // the tree is owned by nodeArena and released with it
+    MCTSRoot = nullptr;
 }
@@ -2,49 +2,150 @@
 #define STUDENTAI_H
 #include "AI.h"
 #include "Board.h"
+#include "TranspositionTable.h"
+#include "NodeArena.h"
+#include "TimeManager.h"
+#include "Random.h"
+#include "Evaluator.h"
+#include "MoveKernel.h"
 #include <chrono>
+#include <climits>
 #include <random>
 #include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
 using namespace std::chrono;
 #pragma once
 
 //The following part should be completed by students.
 //Students can modify anything except the class name and exisiting functions and varibles.
 
-class Node {
+// search options, set from the command line (see SearchConfig::parse)
+struct SearchConfig {
+	int threads = 1;         // --threads: workers sharing one tree
+	int virtualLoss = 3;     // --virtual-loss: visits added to a node while a thread is still simulating below it
+	double moveSeconds = 0;  // --move-seconds: cap on a single search, 0 leaves it to the time manager
+	double totalSeconds = 480; // --total-seconds: game clock for all of our moves
+	bool rootParallel = false; // --parallel root|tree: independent trees per thread merged at the root, or one shared tree
+	int treeMegabytes = 128; // --tree-mb: memory budget of the search tree, nodes, child blocks and boards (split between the trees in root parallel mode)
+	int tableMegabytes = 32; // --tt-mb: transposition table size
+	int heuristicPercent = 30; // --heuristic-playouts: share of playout moves picked by the evaluation instead of at random
+	uint64_t seed = 0;       // --seed: random seed, StudentAI picks one at startup when it is 0
+	int iterations = 0;      // --iterations: fixed iterations per move instead of the clock, with --seed and one thread a game is reproducible
+	int boardInterval = 4;   // --board-interval: only nodes every K plies keep a Board, the others replay their moves from one
+	int raveEquivalence = 0; // --rave: visits at which a child's own statistics and its AMAF statistics weigh the same in selection, 0 turns RAVE off
+	int playoutDepth = -1;   // --playout-depth: plies before a playout is cut off and scored by the evaluation, 0 evaluates the new node without a playout, -1 plays to the end
+	bool ponder = false;     // keep searching the tree on the opponent's time, turned on by the tournament interface
+	// reads "--name value" pairs from argv[first..], unknown options are reported on cerr
+	static SearchConfig parse(int argc, char *argv[], int first);
+};
+
+class Node;
+
+// the children of one node in a single allocation, sized to the legal move count when the node is initialized:
+// the moves in a random order fixed at that point, the child created from moves()[i] once the expansion cursor
+// (the node's childCount) has passed i, and the search statistics of every slot as parallel arrays, so
+// selection scans a few contiguous arrays instead of visiting every child. The block is placed in the tree's
+// arena and nothing in it moves afterwards.
+struct ChildBlock {
+	static size_t bytes(int count); // the storage a block of count moves needs
+	void assign(char *storage, const CompactMove *moves, int count); // copies the moves, the statistics start at zero
+	void moveTo(char *storage); // copies the block to storage and uses that copy from then on
+	int size() const { return count; }
+	char* data() const { return storage; }
+	atomic<double>* wins() const { return reinterpret_cast<atomic<double>*>(storage); }
+	atomic<double>* raveWins() const { return wins() + count; } // AMAF statistics of every move, expanded or not
+	// the transposition table statistics of each child's position, copied when the child is backpropagated, so
+	// selection reads them without probing the table
+	atomic<double>* ttWins() const { return raveWins() + count; }
+	Node** nodes() const { return reinterpret_cast<Node**>(ttWins() + count); }
+	CompactMove* moves() const { return reinterpret_cast<CompactMove*>(nodes() + count); }
+	atomic<int>* visits() const { return reinterpret_cast<atomic<int>*>(moves() + count); }
+	atomic<int>* virtualLoss() const { return visits() + count; }
+	atomic<int>* raveVisits() const { return virtualLoss() + count; }
+	atomic<int>* ttVisits() const { return raveVisits() + count; }
+	atomic<signed char>* proven() const { return reinterpret_cast<atomic<signed char>*>(ttVisits() + count); } // see Node::Proven
+private:
+	char *storage = nullptr;
+	int count = 0;
+};
+
+// nodes live in a NodeArena together with their child blocks and boards, fields read during selection come first
+// so they share a cache line
+// the statistics of a node are held by its parent, in slot `slot` of the parent's ChildBlock, like the move that
+// led to it; only a root uses its own fields. They are updated by several search threads, children are created
+// under expansionLock and published through childCount so selection can read them without locking
+class alignas(64) Node {
 public:
+	// MCTS-Solver values, from the side of the player who moved into the node like wins(). A terminal node is
+	// proven when it is initialized, the others by MCTS::solve from their children.
+	enum Proven : signed char { UNPROVEN = 0, PROVEN_WIN = 1, PROVEN_LOSS = -1, PROVEN_DRAW = 2 };
 	Node* parent;
-	vector<Node*> children;
-	vector<Move> unvisitedMoves;
-	double wins = 0;
-	int visits = 0;
+	atomic<int> childCount{0}; // children created so far, the next expansion takes children.moves()[childCount]
+	ChildBlock children;
+	atomic<int> unvisitedCount{0};
+	int slot = -1;
 	int player;
 	bool initialized = false;
-	bool isLeaf = false;
-	Move move;
-	Board board;
-	Node(Node* parent, Move move, Board board, int player) : parent(parent), move(move), board(board), player(player) {}
+	atomic<bool> expansionLock{false};
+	atomic<signed char> ownProven{UNPROVEN};
+	atomic<double> ownWins{0};
+	atomic<int> ownVisits{0};
+	atomic<int> ownVirtualLoss{0};
+	uint64_t hashKey; // of the position, kept even when the board is not
+	int ply;          // distance from the first root, reRoot keeps it
+	Board* board; // the position in the same arena, only on roots and checkpoint nodes, see MCTS::nodeBoard
+	Node(Node* parent, uint64_t hashKey, int player, Board* board);
+	Node(Node&& other); // used when reRoot moves a subtree to another arena
+	atomic<double>& wins() { return parent != nullptr ? parent->children.wins()[slot] : ownWins; }
+	atomic<int>& visits() { return parent != nullptr ? parent->children.visits()[slot] : ownVisits; }
+	atomic<int>& virtualLoss() { return parent != nullptr ? parent->children.virtualLoss()[slot] : ownVirtualLoss; }
+	atomic<signed char>& proven() { return parent != nullptr ? parent->children.proven()[slot] : ownProven; }
+	const CompactMove& move() const { return parent->children.moves()[slot]; } // the move that led here, a root has none
 	bool isFullyExpanded();
+	void addWins(double score);
 };
 
+typedef NodeArena<Node> TreeArena;
+
 class MCTS {
 public:
 	Node* root;
-	MCTS(Node* root, Board &board, int player);
+	SearchConfig config;
+	TreeArena* arena;                       // where expandNode allocates, expansion stops when it is full
+	TranspositionTable* transpositionTable; // shared statistics per position, may be nullptr
+	const atomic<bool>* stop = nullptr;     // when set, runMCTS returns after the iterations in flight finish
+	const Evaluator* evaluator;             // piece-square tables for the board size
+	const MoveKernel* kernel;               // move generation compiled for the board size, or the generic one
+	TimeManager* timeManager = nullptr;     // decides when runMCTS stops, otherwise config.moveSeconds does
+	static const int CLOCK_CHECK_INTERVAL = 16; // iterations of the calling thread between clock checks
+	MCTS(Node* root, Board &board, int player, const SearchConfig &config, TreeArena* arena, TranspositionTable* transpositionTable = nullptr);
+	static Board* storeBoard(TreeArena &arena, const Board &board); // a history-free copy in the arena, nullptr when it is full
+	static Node* createRoot(TreeArena &arena, const Board &board, int player); // a root with its board, nullptr when the arena is full
 	Node* selectNode(Node* node);
 	Node* expandNode(Node* node);
-	int simulation(Node* node);
-	void backPropagation(Node* node, int result);
-	double getUCT(Node* node);
-	void runMCTS(int time);
+	static const Board& nodeBoard(Node* node); // node->board, or the position replayed on a per-thread board
+	double simulation(Node* node);
+	void backPropagation(Node* node, double score);
+	void updateAmaf(Node* node, double score); // the AMAF statistics of the moves of node played later in the iteration
+	signed char solve(Node* node); // the proven value the children of node give it, UNPROVEN if they do not decide it
+	double provenResult(Node* node); // the simulation score a proven node stands for
+	int bestUCTChild(Node* node, int childCount); // the child with the highest UCT value, the first one on ties
+	int runMCTS(int time); // returns the number of iterations done by all threads
+	bool timeManagerSaysStop(double elapsed, int iterations);
 	Move getBestMove();
+	static Move getBestMove(const vector<Node*> &roots); // sums root child visits over several trees
+	static Move runRootParallel(Board &board, int player, int time, const SearchConfig &config, int *iterations = nullptr);
 	bool isMultipleCapture(const Move &move);
 	double isVulnerableMove(Board &board, const Move &move, int player);
+	double isVulnerableMove(Board &board, const CompactMove &move, int player);
 	bool isPromoting(const Board &board, const Move &move, int player);
+	bool isPromoting(const Board &board, const CompactMove &move, int player);
 	double generalBoardPositionEvaluation(Board &board, const Move &move, int player);
 	static Node* findChildNode(Node* node, const Move &move);
-	static void deleteTree(Node* node);
-	static Node* reRoot(Node *root, const Move &move);
+	static Node* moveTree(Node* node, Node* parent, TreeArena &arena);
+	static Node* reRoot(Node *root, const Move &move, TreeArena &arena, TreeArena &spareArena);
 	static int checkWin(Board &board);
 };
 
@@ -54,13 +155,27 @@ class StudentAI :public AI
 public:
     Board board;
 	Node* MCTSRoot = nullptr;
-	int MCTS_ITERATIONS = 10000;
+	int MCTS_ITERATIONS = INT_MAX; // iterations of all threads per move, set from --iterations, otherwise unbounded
+	SearchConfig config;
+	TranspositionTable transpositionTable; // kept across moves
+	TreeArena nodeArena;  // nodes of the current tree
+	TreeArena spareArena; // the subtree kept by reRoot is moved here before nodeArena is released
 	duration<double, std::milli> timeElapsed = duration<double, std::milli>::zero();
-	const duration<double, std::milli> timeLimit = minutes(8); // 8 minutes total time limit
+	const duration<double, std::milli> timeLimit; // total time limit, 8 minutes unless --total-seconds says otherwise
+	TimeManager timeManager;
+	Xoshiro256 random; // for GetRandomMove, the search threads have their own generators
 	StudentAI(int col, int row, int p);
+	StudentAI(int col, int row, int p, const SearchConfig &config);
 	virtual Move GetMove(Move move);
 	Move GetRandomMove(Move move);
 	~StudentAI();
+private:
+	// pondering: after a reply the tree under MCTSRoot is searched from the opponent's side until their move arrives
+	atomic<bool> stopPondering{false};
+	unique_ptr<MCTS> ponderSearch;
+	thread ponderThread;
+	void startPondering();
+	void finishPondering();
 };
 
 #endif //STUDENTAI_H
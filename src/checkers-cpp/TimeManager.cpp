@@ -0,0 +1,64 @@
+//
+// Per move time budget taken from the game clock.
+//
+
+#include "TimeManager.h"
+#include <algorithm>
+
+constexpr double TimeManager::RESERVE_SECONDS;
+constexpr double TimeManager::MIN_CHECK_SECONDS;
+
+TimeManager::TimeManager(double moveCap) : moveCap(moveCap) {
+}
+
+// a game with more material on the board has more moves to go. The draw counter is only a weak hint: any capture
+// resets it, so it is blended in with at most half the weight, growing as the counter runs, and only when it
+// would shorten the estimate
+int TimeManager::estimateMovesLeft(const Board &board) {
+    int pieces = board.blackCount + board.whiteCount;
+    double estimate = 10 + 2 * pieces;
+    double untilDraw = 6 + (board.tieMax - board.tieCount) / 2;
+    if (untilDraw < estimate && board.tieMax > 0) {
+        double weight = 0.5 * board.tieCount / board.tieMax;
+        estimate = (1 - weight) * estimate + weight * untilDraw;
+    }
+    return max(4, int(estimate + 0.5));
+}
+
+void TimeManager::startMove(const Board &board, double remainingSeconds) {
+    double usable = max(0.0, remainingSeconds - RESERVE_SECONDS);
+    softLimit = usable / estimateMovesLeft(board);
+    hardLimit = min(softLimit * 3, usable * 0.25);
+    if (moveCap > 0) {
+        softLimit = min(softLimit, moveCap);
+        hardLimit = min(hardLimit, moveCap);
+    }
+    softLimit = min(softLimit, hardLimit);
+    lastBest = -1;
+    lastBestChange = 0;
+}
+
+bool TimeManager::shouldStop(double elapsed, int iterations, int bestChild, int bestVisits, int secondVisits) {
+    if (elapsed >= hardLimit) {
+        return true;
+    }
+    if (bestChild != lastBest) {
+        lastBest = bestChild;
+        lastBestChange = elapsed;
+    }
+    // stop as soon as the runner-up could not catch up even if it got every remaining iteration
+    if (elapsed >= MIN_CHECK_SECONDS && iterations > 0) {
+        double planned = elapsed < softLimit ? softLimit : hardLimit;
+        double iterationsLeft = iterations / elapsed * (planned - elapsed);
+        if (bestVisits - secondVisits > iterationsLeft) {
+            return true;
+        }
+    }
+    if (elapsed < softLimit) {
+        return false;
+    }
+    // past the soft limit keep searching towards the hard limit while the choice is unstable:
+    // the best child changed recently or the runner-up is close behind
+    bool unstable = elapsed - lastBestChange < softLimit * 0.25 || secondVisits * 1.25 > bestVisits;
+    return !unstable;
+}
@@ -0,0 +1,31 @@
+//
+// Per move time budget taken from the game clock.
+//
+
+#ifndef CHECKER_TEACHER_TIMEMANAGER_H
+#define CHECKER_TEACHER_TIMEMANAGER_H
+
+#include "Board.h"
+
+// startMove splits the remaining clock over the moves we still expect to play into a soft limit (the normal
+// think time) and a hard limit (never exceeded). The search asks shouldStop periodically with the visit counts
+// of the two most visited root children: it ends past the soft limit unless the decision is still unstable, and
+// before it once the runner-up can no longer catch up in the time that is left.
+class TimeManager {
+public:
+    static constexpr double RESERVE_SECONDS = 3;   // never planned, covers move overhead and timer jitter
+    static constexpr double MIN_CHECK_SECONDS = 0.05; // the visit rate is too noisy to stop early before this
+    double softLimit = 0;
+    double hardLimit = 0;
+    explicit TimeManager(double moveCap = 0); // moveCap > 0 also bounds every move, e.g. --move-seconds
+    static int estimateMovesLeft(const Board &board); // our own moves, from material, nudged down by the draw counter
+    void startMove(const Board &board, double remainingSeconds);
+    bool shouldStop(double elapsed, int iterations, int bestChild, int bestVisits, int secondVisits);
+
+private:
+    double moveCap;
+    int lastBest = -1;
+    double lastBestChange = 0; // elapsed time when the most visited child last changed
+};
+
+#endif //CHECKER_TEACHER_TIMEMANAGER_H
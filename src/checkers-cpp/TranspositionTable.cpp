@@ -0,0 +1,92 @@
+//
+// Position keyed statistics shared by every MCTS node that reaches the same position.
+//
+
+#include "TranspositionTable.h"
+#include <thread>
+
+TranspositionTable::TranspositionTable(size_t megabytes) {
+    // round down to a power of two number of buckets so the bucket index is a mask of the key
+    size_t buckets = 1;
+    size_t budget = megabytes * 1024 * 1024 / (sizeof(TTEntry) * BUCKET_SIZE);
+    while (buckets * 2 <= budget) {
+        buckets *= 2;
+    }
+    bucketMask = buckets - 1;
+    entries.resize(buckets * BUCKET_SIZE);
+    generation = 0;
+    locks.reset(new std::atomic<bool>[LOCK_STRIPES]);
+    for (int i = 0; i < LOCK_STRIPES; i++) {
+        locks[i].store(false);
+    }
+    clear();
+}
+
+void TranspositionTable::lock(size_t bucket) const {
+    while (locks[bucket % LOCK_STRIPES].exchange(true, std::memory_order_acquire)) {
+        std::this_thread::yield();
+    }
+}
+
+void TranspositionTable::unlock(size_t bucket) const {
+    locks[bucket % LOCK_STRIPES].store(false, std::memory_order_release);
+}
+
+void TranspositionTable::clear() {
+    for (TTEntry &entry : entries) {
+        entry.key = 0;
+        entry.wins = 0.0;
+        entry.visits = 0;
+        entry.generation = 0;
+    }
+}
+
+void TranspositionTable::newSearch() {
+    generation++;
+}
+
+void TranspositionTable::update(uint64_t key, double winScore, TTEntry *updated) {
+    size_t index = key & bucketMask;
+    TTEntry *bucket = &entries[index * BUCKET_SIZE];
+    TTEntry *victim = nullptr;
+    lock(index);
+    for (int i = 0; i < BUCKET_SIZE; i++) {
+        TTEntry &entry = bucket[i];
+        if (entry.key == key) {
+            entry.wins += winScore;
+            entry.visits++;
+            entry.generation = generation;
+            if (updated != nullptr) {
+                *updated = entry;
+            }
+            unlock(index);
+            return;
+        }
+        // replacement: empty slots first, then entries left over from older searches, then the least visited
+        if (victim == nullptr) {
+            victim = &entry;
+        } else if (victim->visits > 0 && (entry.visits == 0
+                   || (entry.generation != generation && victim->generation == generation)
+                   || (entry.generation == victim->generation && entry.visits < victim->visits))) {
+            victim = &entry;
+        }
+    }
+    victim->key = key;
+    victim->wins = winScore;
+    victim->visits = 1;
+    victim->generation = generation;
+    if (updated != nullptr) {
+        *updated = *victim;
+    }
+    unlock(index);
+}
+
+size_t TranspositionTable::used() const {
+    size_t count = 0;
+    for (const TTEntry &entry : entries) {
+        if (entry.visits > 0) {
+            count++;
+        }
+    }
+    return count;
+}
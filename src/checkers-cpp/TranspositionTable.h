@@ -0,0 +1,45 @@
+//
+// Position keyed statistics shared by every MCTS node that reaches the same position.
+//
+
+#ifndef CHECKER_TEACHER_TRANSPOSITIONTABLE_H
+#define CHECKER_TEACHER_TRANSPOSITIONTABLE_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// wins are counted for the player who moved into the position, the same convention as Node::wins
+struct TTEntry {
+    uint64_t key;
+    double wins;
+    int visits;
+    int generation;
+};
+
+// buckets are guarded by a small set of striped spin locks, so search threads can share one table
+class TranspositionTable {
+public:
+    static const int BUCKET_SIZE = 4;
+    static const int LOCK_STRIPES = 1024;
+    explicit TranspositionTable(size_t megabytes);
+    TranspositionTable(const TranspositionTable&) = delete;
+    TranspositionTable& operator=(const TranspositionTable&) = delete;
+    void newSearch();                       // ages every entry, entries from older searches are replaced first
+    void update(uint64_t key, double winScore, TTEntry *updated = nullptr); // updated gets a copy of the entry afterwards
+    void clear();
+    size_t capacity() const { return entries.size(); }
+    size_t used() const;
+
+private:
+    std::vector<TTEntry> entries;
+    size_t bucketMask;
+    int generation;
+    std::unique_ptr<std::atomic<bool>[]> locks;
+    void lock(size_t bucket) const;
+    void unlock(size_t bucket) const;
+};
+
+#endif //CHECKER_TEACHER_TRANSPOSITIONTABLE_H
@@ -15,11 +15,15 @@ int main(int argc, char *argv[])
 	int p = atoi(argv[3]);
 	string mode = argv[4];
 	int order = 0;
+	int firstOption = 5;
     if (mode == "m" || mode == "manual"|| mode == "s"|| mode == "self")
     {
         order = atoi(argv[5]);
+        firstOption = 6;
     }
-	GameLogic main(col,row,p, mode, order);//col,row,p,g,mode,debug
+	// optional search settings after the positional arguments, e.g. "--threads 8"
+	SearchConfig config = SearchConfig::parse(argc, argv, firstOption);
+	GameLogic main(col,row,p, mode, order, config);//col,row,p,g,mode,debug
 	main.Run();
 
 	return 0;